@@ -0,0 +1,16 @@
+include(FetchContent)
+
+# ZYDIS
+# Only needed by the offline tools outside of Windows, the DLL gets Zydis through safetyhook.
+set(ZYDIS_BUILD_TOOLS OFF CACHE BOOL "" FORCE)
+set(ZYDIS_BUILD_EXAMPLES OFF CACHE BOOL "" FORCE)
+FetchContent_Declare(
+    zydis
+    GIT_REPOSITORY https://github.com/zyantific/zydis.git
+    GIT_TAG        v4.1.1
+    EXCLUDE_FROM_ALL
+)
+
+FetchContent_MakeAvailable(
+    zydis
+)
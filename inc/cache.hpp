@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+
+// Local includes
+#include "types.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Identifies one signature in one build of a module.
+     */
+    struct CacheKey {
+        u32 timeDateStamp = 0;
+        u32 checkSum = 0;
+        u32 sizeOfImage = 0;
+        u64 signatureHash = 0;
+
+        bool operator==(const CacheKey&) const = default;
+    };
+
+    /**
+     * @brief Hashes the text of a signature using 64-bit FNV-1a.
+     *
+     * @param signature Signature as written in the source.
+     * @param section Section the signature is scanned in, part of the hash since the
+     *      same signature may resolve differently in another section.
+     * @param match Index of the hit that is used, see `Utils::SignatureHook::match`.
+     * @param scope Where hits are accepted, see `Utils::Scope`.
+     * @param unique Whether ambiguous signatures are rejected, such a signature must not
+     *      reuse the RVA stored for the same signature without the check.
+     * @return u64 containing the hash.
+     */
+    constexpr u64 hashSignature(std::string_view signature, std::string_view section = "", u32 match = 0, u32 scope = 0, bool unique = false)
+    {
+        u64 hash = 0xCBF29CE484222325;
+        auto mix = [&hash](std::string_view text) {
+            for (char c : text) {
+                hash ^= static_cast<u8>(c);
+                hash *= 0x100000001B3;
+            }
+        };
+        mix(signature);
+        hash ^= 0xFF;
+        hash *= 0x100000001B3;
+        mix(section);
+        for (u32 value : { match, scope, static_cast<u32>(unique) }) {
+            for (u32 i = 0; i < 4; i++) {
+                hash ^= static_cast<u8>(value >> (i * 8));
+                hash *= 0x100000001B3;
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * @brief On-disk cache of resolved signature RVAs.
+     * @details Game builds rarely change between launches, so the RVA a signature was
+     *      found at last time is very likely still correct. Entries are keyed on the PE
+     *      timestamp, checksum and image size of the module together with the hash of
+     *      the signature, a new game build therefore never reuses stale entries. Callers
+     *      must still verify the signature at a cached RVA before trusting it.
+     *      Entries of builds that were not looked up or stored since `load()` are dropped
+     *      by `save()`, so updates of the game do not grow the file forever.
+     *
+     *      The file is plain text, one entry per line:
+     *      `<timeDateStamp> <checkSum> <sizeOfImage> <signatureHash> <rva>` all in hex.
+     */
+    class SignatureCache {
+    public:
+        /**
+         * @brief Loads the cache from disk, a missing or unreadable file yields an empty cache.
+         *
+         * @param path Path of the cache file.
+         */
+        void load(const std::string& path);
+
+        /**
+         * @brief Writes the cache to disk if it was modified since it was loaded.
+         * @details Entries of module builds that were not passed to `find()` or `store()`
+         *      since loading are dropped first.
+         *
+         * @param path Path of the cache file.
+         * @return true if the file is up to date.
+         */
+        bool save(const std::string& path);
+
+        /**
+         * @brief Looks up the RVA stored for a key.
+         *
+         * @param key Module build and signature to look up.
+         * @return std::optional<u32> containing the cached RVA.
+         */
+        std::optional<u32> find(const CacheKey& key) const;
+
+        /**
+         * @brief Stores or replaces the RVA of a key.
+         *
+         * @param key Module build and signature.
+         * @param rva RVA the signature was found at.
+         */
+        void store(const CacheKey& key, u32 rva);
+
+        /**
+         * @brief Removes the entry of a key, used when a cached RVA failed verification.
+         *
+         * @param key Module build and signature.
+         */
+        void erase(const CacheKey& key);
+
+    private:
+        struct Entry {
+            CacheKey key;
+            u32 rva;
+        };
+
+        void touch(const CacheKey& key) const;
+
+        std::vector<Entry> entries;
+        mutable std::vector<CacheKey> builds;   // Builds in use, `signatureHash` is unused
+        bool dirty = false;
+    };
+}
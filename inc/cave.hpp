@@ -0,0 +1,157 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <initializer_list>
+#include <cstring>
+
+// Local includes
+#include "types.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Native instructions to run at a hook site, built with the Zydis encoder.
+     * @details Instead of calling back into C++ through a mid-function hook, which saves
+     *      and restores every general purpose and XMM register on each call, the
+     *      instructions are placed in a code cave next to the module and the hooked
+     *      site jumps straight into it. Constants the instructions need are stored in
+     *      the cave as well.
+     *
+     * @code
+     * Utils::CaveCode code;
+     * code.emit(ZYDIS_MNEMONIC_MULSS, { Utils::CaveCode::reg(ZYDIS_REGISTER_XMM0), code.constant(1.125f) });
+     * @endcode
+     */
+    class CaveCode {
+    public:
+        /**
+         * @brief Appends an instruction.
+         * @details Memory operands relative to RIP refer to constants of this cave, use
+         *      `constant()` to create them.
+         *
+         * @param mnemonic Mnemonic of the instruction.
+         * @param operands Operands of the instruction in Intel order.
+         * @return CaveCode& for chaining.
+         */
+        CaveCode& emit(ZydisMnemonic mnemonic, std::initializer_list<ZydisEncoderOperand> operands);
+
+        /**
+         * @brief Returns a register operand.
+         */
+        static ZydisEncoderOperand reg(ZydisRegister value);
+
+        /**
+         * @brief Returns an immediate operand.
+         */
+        static ZydisEncoderOperand imm(i64 value);
+
+        /**
+         * @brief Returns a memory operand addressed relative to a register.
+         *
+         * @param base Base register, not RIP.
+         * @param displacement Displacement from the base register.
+         * @param size Size of the operand in bytes.
+         */
+        static ZydisEncoderOperand mem(ZydisRegister base, i64 displacement, u16 size);
+
+        /**
+         * @brief Stores a constant in the cave.
+         *
+         * @tparam T Trivially copyable type of the constant.
+         * @param value Value of the constant.
+         * @return ZydisEncoderOperand memory operand that reads the constant.
+         */
+        template <typename T>
+        ZydisEncoderOperand constant(const T& value) {
+            size_t offset = (data.size() + alignof(T) - 1) & ~(alignof(T) - 1);
+            data.resize(offset + sizeof(T));
+            std::memcpy(data.data() + offset, &value, sizeof(T));
+
+            ZydisEncoderOperand operand{};
+            operand.type = ZYDIS_OPERAND_TYPE_MEMORY;
+            operand.mem.base = ZYDIS_REGISTER_RIP;
+            operand.mem.displacement = static_cast<i64>(offset);
+            operand.mem.size = static_cast<u16>(sizeof(T));
+            return operand;
+        }
+
+        /**
+         * @brief Checks whether no instruction was emitted.
+         */
+        bool empty() const { return instructions.empty(); }
+
+    private:
+        friend struct Cave;
+
+        std::vector<ZydisEncoderRequest> instructions;
+        std::vector<u8> data;
+    };
+
+    /**
+     * @brief A code cave built for one hook site.
+     * @details The cave holds the injected instructions, the instructions displaced by
+     *      the jump at the site relocated to the cave, a jump back behind them and the
+     *      constants. The cave itself is written by `build()` and left execute-read, the
+     *      site is left alone, `jump` holds the bytes that divert it so they can be
+     *      written together with other patches. The instruction cache is flushed by
+     *      whoever writes the jump.
+     */
+    struct Cave {
+        u64 address = 0;
+        size_t size = 0;
+        std::vector<u8> jump;                           // Bytes to write at the site, a jmp rel32 padded with nops
+        std::vector<std::pair<u64, u64>> redirects;     // Displaced instruction boundaries and their copies in the cave
+
+        /**
+         * @brief Builds a code cave for a hook site.
+         * @details Whole instructions at the site are displaced until a 5 byte jump fits.
+         *      Relative branches and RIP-relative memory operands among them are
+         *      re-encoded for their new address. The cave is allocated where a rel32
+         *      reaches it from the site and reaches every target of those operands from
+         *      it. It is never freed, threads may still run in it after the site is
+         *      restored.
+         *
+         * @param site Address to hook.
+         * @param code Instructions to run before the displaced instructions.
+         * @return std::optional<Cave> the cave, or std::nullopt if the site could not be
+         *      decoded or relocated or no memory was available in reach.
+         */
+        static std::optional<Cave> build(u64 site, const CaveCode& code);
+
+        /**
+         * @brief Gives the memory of a cave back for later caves.
+         * @details Only for caves whose jump was never written, nothing can be running
+         *      in them.
+         *
+         * @param cave Cave returned by `build()`.
+         */
+        static void release(const Cave& cave);
+    };
+}
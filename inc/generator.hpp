@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <optional>
+
+// Local includes
+#include "types.hpp"
+#include "pe.hpp"
+#include "image.hpp"
+#include "suffixarray.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief A signature generated for a location in an image.
+     */
+    struct GeneratedSignature {
+        u32 rva = 0;        // Where the signature starts
+        u32 offset = 0;     // Offset of the requested location from `rva`
+        size_t length = 0;  // Length in bytes
+        std::string text;   // IDA-style, instructions separated by four spaces
+    };
+
+    /**
+     * @brief Generates the shortest signatures that are unique in an image.
+     * @details The instructions at a location are decoded and the bytes that change
+     *      between builds or load addresses are wildcarded: RIP-relative displacements,
+     *      relative branch targets and relocated bytes. The shortest prefix that only
+     *      matches at the location is then found with a binary search over the length,
+     *      every step being one `CodeIndex` query instead of a scan.
+     */
+    class SignatureGenerator {
+    public:
+        /**
+         * @param image Image to generate signatures for, has to outlive the generator.
+         * @param index Code index of `image`, has to outlive the generator.
+         */
+        SignatureGenerator(const ImageFile& image, const CodeIndex& index);
+
+        /**
+         * @brief Generates a signature for a location.
+         *
+         * @param rva Location, has to be the start of an instruction.
+         * @param back Also try signatures starting up to this many instructions
+         *      earlier, the shortest signature wins.
+         * @return std::optional<GeneratedSignature> containing the signature, std::nullopt
+         *      if no signature of up to `Signature::MAX_SIZE` bytes is unique.
+         */
+        std::optional<GeneratedSignature> generate(u32 rva, size_t back = 0) const;
+
+    private:
+        const ImageFile& image;
+        const CodeIndex& index;
+        FunctionIndex functions;
+        std::vector<Relocation> relocations;
+    };
+}
@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+// 3rd party includes
+#include "safetyhook.hpp"
+
+// Local includes
+#include "types.hpp"
+#include "cave.hpp"
+#include "regs.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief One hooked address shared by all callbacks that hook it.
+     * @details Only one stub is injected per address. It saves the registers needed by
+     *      any of the callbacks and calls `dispatch()`, which runs the callbacks in
+     *      order from a flat array. The array can be replaced while the game is
+     *      running, a callback added to an existing site costs a call and not another
+     *      trampoline.
+     *
+     *      A thread may still be dispatching from an array after it was replaced, and
+     *      there is no way to tell when it is done. Every array therefore lives as
+     *      long as the site, each `swap()` or `update()` keeps one more. Sites are only
+     *      changed when hooks are injected, not per frame, so this stays small.
+     *
+     * @code
+     * if (auto* site = Utils::findHookSite(address)) {
+     *     site->update([](auto& callbacks) {
+     *         callbacks.pop_back();
+     *     });
+     * }
+     * @endcode
+     */
+    class HookSite {
+    public:
+        /**
+         * @brief Creates a site for the given callbacks.
+         * @details The registers saved by the stub are fixed here, the union of the
+         *      registers of `callbacks`.
+         */
+        HookSite(u64 address, std::vector<Utils::HookCallback> callbacks);
+
+        HookSite(const HookSite&) = delete;
+        HookSite& operator=(const HookSite&) = delete;
+
+        /**
+         * @brief Returns the address that is hooked.
+         */
+        u64 address() const { return site; }
+
+        /**
+         * @brief Builds the stub that calls `dispatch()` for this site.
+         */
+        Utils::CaveCode code() const;
+
+        /**
+         * @brief Returns a copy of the current callbacks.
+         * @details To change them use `update()`, handing an edited copy to `swap()`
+         *      would overwrite an update made in between.
+         */
+        std::vector<Utils::HookCallback> callbacks() const;
+
+        /**
+         * @brief Atomically replaces the callbacks.
+         * @details Threads already dispatching finish with the previous callbacks, the
+         *      previous arrays are kept for that reason.
+         *
+         * @param callbacks New callbacks in the order to call them.
+         * @return true if replaced, false if a callback needs a register the stub does
+         *      not save.
+         */
+        bool swap(std::vector<Utils::HookCallback> callbacks);
+
+        /**
+         * @brief Atomically edits the callbacks.
+         * @details `edit` receives a copy of the current callbacks and runs under the
+         *      lock of the site, so concurrent updates are applied one after another
+         *      and none of them is lost.
+         *
+         * @param edit Function taking `std::vector<Utils::HookCallback>&`.
+         * @return true if replaced, false if a callback needs a register the stub does
+         *      not save, the callbacks are left unchanged then.
+         */
+        template <typename Edit>
+        bool update(Edit&& edit)
+        {
+            std::lock_guard lock(mutex);
+            Callbacks callbacks = *current.load(std::memory_order_relaxed);
+            edit(callbacks);
+            return replace(std::move(callbacks));
+        }
+
+        /**
+         * @brief Entry point of the stub, calls every callback of `site`.
+         */
+        static void dispatch(Utils::Xmm* slots, const HookSite* site, u64* pushed);
+
+    private:
+        using Callbacks = std::vector<Utils::HookCallback>;
+
+        bool replace(Callbacks callbacks);
+
+        u64 site;
+        std::vector<Utils::Reg> registers;
+        std::array<u8, static_cast<size_t>(Utils::Reg::xmm15) + 1> index;
+        std::atomic<const Callbacks*> current;
+        std::vector<std::unique_ptr<const Callbacks>> generations;
+        mutable std::mutex mutex;
+    };
+
+    /**
+     * @brief Wraps a `SafetyHookContext` callback for the dispatcher of a hook site.
+     * @details The site then saves every register. The flags can be changed, changes
+     *      to `rsp` and `rip` are ignored.
+     */
+    Utils::HookCallback wrapContext(safetyhook::MidHookFn callback);
+}
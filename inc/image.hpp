@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <span>
+#include <optional>
+#include <memory>
+
+// Local includes
+#include "types.hpp"
+#include "pe.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Section contents of an image file together with their RVA.
+     */
+    struct MappedSection {
+        u32 rva = 0;
+        std::span<const u8> bytes;
+    };
+
+    /**
+     * @brief A PE image read from disk, used by the offline tools.
+     * @details The file is not loaded by the OS loader, so sections are accessed
+     *      through their raw file offsets and mapped to RVAs via the section table.
+     *      The file is memory-mapped read-only, only the pages that are actually
+     *      touched are read from disk. Copies share the mapping.
+     */
+    class ImageFile {
+    public:
+        /**
+         * @brief Maps and parses an image file.
+         *
+         * @param path Path of the executable.
+         * @return true if the file was mapped and is a valid PE32+ image.
+         */
+        bool load(const std::string& path);
+
+        /**
+         * @brief Collects the contents of sections.
+         * @details Uses the same selection rule as `Utils::scanRegions`. Only the
+         *      initialized part of each section is returned, a section is cut short if
+         *      its raw data runs past the end of the file.
+         *
+         * @param section Name of the section to use, e.g. ".rdata". If empty all
+         *      executable sections are used.
+         * @return std::vector<MappedSection> ordered by RVA.
+         */
+        std::vector<MappedSection> sections(const std::string& section = "") const;
+
+        /**
+         * @brief Converts an RVA into a pointer into the file contents.
+         *
+         * @param rva RVA to convert.
+         * @param size Number of bytes that have to be readable at the RVA.
+         * @return const u8* into the file, nullptr if the range is not backed by the file.
+         */
+        const u8* at(u32 rva, size_t size = 1) const;
+
+        /**
+         * @brief Builds the function index from the exception directory.
+         *
+         * @return FunctionIndex of the image, empty if it has no .pdata.
+         */
+        FunctionIndex functions() const;
+
+        /**
+         * @brief Parses the base relocation directory.
+         *
+         * @return std::vector<Relocation> ordered by RVA, empty if the image has none.
+         */
+        std::vector<Relocation> relocations() const;
+
+        const PeInfo& info() const { return pe; }
+        std::span<const u8> data() const { return bytes; }
+
+    private:
+        std::shared_ptr<const u8> mapping;
+        std::span<const u8> bytes;
+        PeInfo pe;
+    };
+}
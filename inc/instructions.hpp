@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <span>
+#include <array>
+
+// Local includes
+#include "types.hpp"
+#include "pe.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Kind of an instruction operand, independent of the registers involved.
+     */
+    enum class OperandKind : u8 {
+        None,
+        Register,
+        Memory,
+        Immediate,
+        Pointer
+    };
+
+    /**
+     * @brief Compact description of one decoded instruction.
+     */
+    struct Instruction {
+        u32 rva = 0;
+        u16 mnemonic = 0;                   // ZydisMnemonic
+        u8 length = 0;
+        u8 operandCount = 0;                // Visible operands only
+        std::array<OperandKind, 4> kinds{};
+        std::array<u16, 4> registers{};     // ZydisRegister of register operands, 0 otherwise
+    };
+
+    /**
+     * @brief An instruction referring to a value, either a constant or an address.
+     */
+    struct Reference {
+        u32 value = 0;  // 32-bit immediate, or the RVA targeted by a RIP-relative operand or branch
+        u32 rva = 0;    // RVA of the referring instruction
+    };
+
+    /**
+     * @brief Sequence of instructions to look for, see `compileInstructionPattern`.
+     */
+    struct InstructionPattern {
+        struct Operand {
+            enum class Type : u8 { Any, Kind, Register, RegisterClass };
+            Type type = Type::Any;
+            OperandKind kind = OperandKind::None;
+            u16 value = 0;                  // ZydisRegister or ZydisRegisterClass
+        };
+
+        struct Element {
+            bool anyInstruction = false;
+            u16 mnemonic = 0;
+            bool checkOperands = false;
+            u8 operandCount = 0;
+            std::array<Operand, 4> operands{};
+        };
+
+        std::vector<Element> elements;
+    };
+
+    /**
+     * @brief Compiles an instruction sequence signature.
+     * @details Instructions are separated by ';', each one is written as a mnemonic
+     *      followed by an optional comma separated operand list. An instruction written
+     *      without operands matches regardless of its operands:
+     *
+     * - **?** as the mnemonic matches any instruction.
+     * - **?** as an operand matches any operand.
+     * - **reg**, **mem**, **imm** and **ptr** match any operand of that kind.
+     * - **gpr8?**, **gpr16?**, **gpr32?**, **gpr64?**, **xmm?**, **ymm?** and **zmm?**
+     *      match any register of that class.
+     * - A register name such as **xmm0** matches exactly that register.
+     *
+     * @param text Instruction sequence, e.g. `"movss mem, xmm?; call imm"`.
+     * @return InstructionPattern ready to be matched against an `InstructionIndex`.
+     * @throws std::invalid_argument if a mnemonic, register or operand is unknown.
+     */
+    InstructionPattern compileInstructionPattern(std::string_view text);
+
+    /**
+     * @brief Decodes one instruction and marks the bytes that change between builds.
+     * @details The displacement of RIP-relative operands and the target of relative
+     *      branches depend on where code and data end up, so a signature should not
+     *      rely on them. Those bytes are cleared in the mask, every other byte is set
+     *      to 0xFF.
+     *
+     * @param code Bytes starting at the instruction.
+     * @param mask Receives the mask of the instruction, needs room for 15 bytes.
+     * @return size_t containing the length of the instruction, 0 if it is invalid.
+     */
+    size_t instructionMask(std::span<const u8> code, std::span<u8> mask);
+
+    /**
+     * @brief Register and layout independent summary of a function's code.
+     */
+    struct FunctionShape {
+        u64 hash = 0;               // Hash over the mnemonics and operand kinds
+        std::vector<u32> offsets;   // Offset of every instruction from the function start
+    };
+
+    /**
+     * @brief Summarizes the instructions of a function.
+     * @details Only the mnemonics and operand kinds go into the hash, so the shape of a
+     *      function survives other register allocation, moved data and moved callees,
+     *      which makes it suitable for matching functions between two builds.
+     *
+     * @param code Bytes of the function.
+     * @return FunctionShape of the code up to its end or first invalid instruction.
+     */
+    FunctionShape functionShape(std::span<const u8> code);
+
+    /**
+     * @brief Decoded instructions of a module, ordered by address.
+     * @details Signatures matched against the index survive changes in register
+     *      allocation or displacements that would break a byte signature. Decoding
+     *      follows the function boundaries from .pdata so data islands never knock
+     *      the decoder out of sync, functions are decoded on several threads.
+     *
+     *      While decoding, the 32-bit immediates and the targets of RIP-relative
+     *      operands and relative branches are collected into sorted cross-reference
+     *      tables, answering "who uses constant X" or "who reads address Y" in
+     *      O(log n).
+     */
+    class InstructionIndex {
+    public:
+        InstructionIndex() = default;
+
+        /**
+         * @brief Decodes every function of a module.
+         *
+         * @param base Base address of the module.
+         * @param functions Function ranges to decode, see `FunctionIndex`.
+         * @param threads Number of worker threads, 0 uses all hardware threads.
+         */
+        InstructionIndex(const u8* base, std::span<const Function> functions, u32 threads = 0);
+
+        /**
+         * @brief Decodes memory regions linearly, for modules without .pdata.
+         * @details Bytes that do not decode are skipped one at a time.
+         *
+         * @param base Base address of the module.
+         * @param regions Code regions of the module, ordered by address.
+         */
+        InstructionIndex(const u8* base, std::span<const std::span<const u8>> regions);
+
+        /**
+         * @brief Finds every occurrence of an instruction sequence.
+         * @details The instructions of a match have to follow each other directly
+         *      in memory.
+         *
+         * @param pattern Compiled instruction sequence.
+         * @return std::vector<u32> containing the RVA of the first instruction of every
+         *      match in ascending order.
+         */
+        std::vector<u32> find(const InstructionPattern& pattern) const;
+
+        /**
+         * @brief Finds the instructions that use a 32-bit immediate.
+         *
+         * @param value Immediate to look up, sign-extended immediates are matched by
+         *      their low 32 bits.
+         * @return std::span<const Reference> of the users ordered by RVA.
+         */
+        std::span<const Reference> constantUses(u32 value) const;
+
+        /**
+         * @brief Finds the instructions that refer to an address.
+         * @details Covers RIP-relative memory operands, such as `movss xmm0,[rip+X]`,
+         *      and the targets of relative calls and jumps.
+         *
+         * @param rva Target RVA to look up.
+         * @return std::span<const Reference> of the referring instructions ordered by RVA.
+         */
+        std::span<const Reference> referencesTo(u32 rva) const;
+
+        std::span<const Instruction> instructions() const { return decoded; }
+        bool empty() const { return decoded.empty(); }
+
+    private:
+        void sortReferences();
+
+        std::vector<Instruction> decoded;
+        std::vector<Reference> immediates;
+        std::vector<Reference> targets;
+    };
+}
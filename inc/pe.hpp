@@ -0,0 +1,155 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <span>
+#include <optional>
+#include <array>
+
+// Local includes
+#include "types.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Section of a PE image as described by its section table.
+     */
+    struct Section {
+        std::string name;
+        u32 rva = 0;
+        u32 size = 0;
+        u32 rawOffset = 0;
+        u32 rawSize = 0;
+        u32 characteristics = 0;
+
+        bool executable() const { return (characteristics & 0x20000000) != 0; } // IMAGE_SCN_MEM_EXECUTE
+    };
+
+    /**
+     * @brief Location of one of the tables listed in the optional header.
+     */
+    struct DataDirectory {
+        u32 rva = 0;
+        u32 size = 0;
+    };
+
+    constexpr size_t DIRECTORY_EXCEPTION = 3;   // IMAGE_DIRECTORY_ENTRY_EXCEPTION, the .pdata table
+    constexpr size_t DIRECTORY_BASERELOC = 5;   // IMAGE_DIRECTORY_ENTRY_BASERELOC, the .reloc table
+    constexpr size_t DIRECTORY_COUNT = 16;
+
+    /**
+     * @brief The parts of the PE headers the fix is interested in.
+     */
+    struct PeInfo {
+        u32 timeDateStamp = 0;
+        u32 checkSum = 0;
+        u32 sizeOfImage = 0;
+        u32 sizeOfHeaders = 0;
+        std::array<DataDirectory, DIRECTORY_COUNT> directories = {};
+        std::vector<Section> sections;
+    };
+
+    /**
+     * @brief Address range of one function, taken from a `RUNTIME_FUNCTION` entry.
+     */
+    struct Function {
+        u32 begin = 0;  // RVA of the first byte
+        u32 end = 0;    // RVA one past the last byte
+    };
+
+    /**
+     * @brief Index of the function boundaries of an x64 image.
+     * @details Every non-leaf function of an x64 image has a `RUNTIME_FUNCTION` entry
+     *      in the exception directory (.pdata) describing where its code starts and
+     *      ends. Functions split into several chunks by the compiler get one entry per
+     *      chunk. Leaf functions without an entry are simply not part of the index.
+     */
+    class FunctionIndex {
+    public:
+        FunctionIndex() = default;
+
+        /**
+         * @brief Builds the index from the raw exception directory.
+         *
+         * @param table Bytes of the exception directory, an array of 12 byte
+         *      `RUNTIME_FUNCTION` entries.
+         */
+        explicit FunctionIndex(std::span<const u8> table);
+
+        /**
+         * @brief Finds the function containing an RVA in O(log n).
+         *
+         * @param rva RVA to look up.
+         * @return const Function* containing `rva`, nullptr if it is not inside a function.
+         */
+        const Function* find(u32 rva) const;
+
+        /**
+         * @brief Checks whether a range lies entirely inside one function.
+         *
+         * @param rva RVA of the first byte of the range.
+         * @param size Size of the range in bytes.
+         * @return true if the range does not cross a function boundary.
+         */
+        bool contains(u32 rva, u32 size) const;
+
+        std::span<const Function> functions() const { return ranges; }
+        bool empty() const { return ranges.empty(); }
+
+    private:
+        std::vector<Function> ranges;
+    };
+
+    /**
+     * @brief A location the loader patches when the image is not loaded at its preferred base.
+     */
+    struct Relocation {
+        u32 rva = 0;
+        u8 size = 0;    // Number of bytes patched
+    };
+
+    /**
+     * @brief Parses the base relocation table.
+     *
+     * @param table Bytes of the base relocation directory.
+     * @return std::vector<Relocation> ordered by RVA, padding entries are skipped.
+     */
+    std::vector<Relocation> parseRelocations(std::span<const u8> table);
+
+    /**
+     * @brief Parses the headers of a 64-bit PE image.
+     * @details Only reads the DOS header, the NT headers and the section table, so
+     *      `data` may either be a loaded module or the raw contents of the file on disk.
+     *      Every read is bounds checked against `data`, headers that are truncated or
+     *      not PE32+ are rejected.
+     *
+     * @param data Bytes starting at the DOS header.
+     * @return std::optional<PeInfo> containing the parsed headers or std::nullopt if
+     *      `data` is not a valid PE32+ image.
+     */
+    std::optional<PeInfo> parsePe(std::span<const u8> data);
+}
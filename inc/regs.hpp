@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <cstring>
+
+// Local includes
+#include "types.hpp"
+#include "cave.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Registers a lightweight mid-function hook can give its callback.
+     * @details The stack pointer and the flags are not available through `Utils::Regs`,
+     *      the stub needs them itself.
+     */
+    enum class Reg : u8 {
+        rax, rcx, rdx, rbx, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15,
+        xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+        xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15
+    };
+
+    /**
+     * @brief Value of an XMM register as the different lane types.
+     */
+    union Xmm {
+        uint8_t u8[16];
+        uint16_t u16[8];
+        uint32_t u32[4];
+        uint64_t u64[2];
+        float f32[4];
+        double f64[2];
+    };
+
+    /**
+     * @brief Calls one hook callback with the registers saved by the stub of its site.
+     *
+     * @param slots Registers saved by the stub, one 16 byte slot each.
+     * @param index Slot of every `Utils::Reg`, 0xFF if the site does not save it.
+     * @param pushed Registers pushed by the stub: rbx, r11 down to rax, then the flags.
+     * @param callback The callback.
+     */
+    using HookAdapter = void (*)(Utils::Xmm* slots, const u8* index, u64* pushed, void* callback);
+
+    /**
+     * @brief A hook callback together with the registers it needs.
+     */
+    struct HookCallback {
+        HookAdapter adapter;
+        void* callback;
+        std::span<const Utils::Reg> registers;
+    };
+
+    /**
+     * @brief Builds the stub of a lightweight mid-function hook.
+     * @details The stub saves the volatile registers a call may clobber, copies the
+     *      requested registers into slots on the stack, calls `callback(slots,
+     *      argument, pushed)` and writes the registers back. The non-volatile
+     *      registers that are not requested are preserved by the callback itself and
+     *      are not touched. Like `SafetyHookMid` the upper halves of the YMM registers
+     *      are not kept.
+     *
+     * @param registers Registers in the order of their slots.
+     * @param callback Address of the function to call.
+     * @param argument Second argument of the function.
+     * @return Utils::CaveCode the stub, to be injected with `Utils::injectCave`.
+     */
+    Utils::CaveCode midHookCode(std::span<const Utils::Reg> registers, u64 callback, u64 argument);
+
+    /**
+     * @brief The registers a lightweight mid-function hook reads and writes.
+     * @details Declared as the parameter of the callback of `Utils::injectHook`, only
+     *      the listed registers are saved for the callback instead of the full
+     *      `SafetyHookContext`. Changes to them are written back when the callback
+     *      returns. Callbacks that share a site see each other's changes.
+     *
+     * @code
+     * Utils::injectHook(enable, module, hook, [](Utils::Regs<Utils::Reg::xmm0>& regs) {
+     *     regs.get<Utils::Reg::xmm0>().f32[0] = 1.0f;
+     * });
+     * @endcode
+     *
+     * @tparam R Registers the callback uses.
+     */
+    template <Utils::Reg... R>
+    struct alignas(16) Regs {
+        static_assert(sizeof...(R) != 0, "a hook needs at least one register");
+
+        static constexpr std::array<Utils::Reg, sizeof...(R)> registers = { R... };
+
+        /**
+         * @brief Returns a register, only registers listed in `R` are available.
+         *
+         * @return u64& for general purpose registers, Utils::Xmm& for XMM registers.
+         */
+        template <Utils::Reg r>
+        auto& get() {
+            constexpr size_t index = slot(r);
+            static_assert(index < sizeof...(R), "register is not listed in Regs");
+            if constexpr (r >= Utils::Reg::xmm0) {
+                return slots[index].xmm;
+            }
+            else {
+                return slots[index].gpr;
+            }
+        }
+
+        /**
+         * @brief Wraps a callback for the dispatcher of a hook site.
+         */
+        static Utils::HookCallback wrap(void (*callback)(Regs&)) {
+            return { &adapt, reinterpret_cast<void*>(callback), registers };
+        }
+
+    private:
+        static constexpr size_t slot(Utils::Reg r) {
+            for (size_t i = 0; i < registers.size(); i++) {
+                if (registers[i] == r) {
+                    return i;
+                }
+            }
+            return registers.size();
+        }
+
+        union Slot {
+            u64 gpr;
+            Utils::Xmm xmm;
+        };
+
+        static_assert(sizeof(Slot) == 16, "the stub places a slot every 16 bytes");
+
+        // The site may save more registers than this callback uses, in another order.
+        static void adapt(Utils::Xmm* saved, const u8* index, u64*, void* callback) {
+            Regs regs;
+            for (size_t i = 0; i < registers.size(); i++) {
+                std::memcpy(&regs.slots[i], &saved[index[static_cast<size_t>(registers[i])]], sizeof(Slot));
+            }
+            reinterpret_cast<void (*)(Regs&)>(callback)(regs);
+            for (size_t i = 0; i < registers.size(); i++) {
+                std::memcpy(&saved[index[static_cast<size_t>(registers[i])]], &regs.slots[i], sizeof(Slot));
+            }
+        }
+
+        Slot slots[sizeof...(R)];
+    };
+
+    template <typename T>
+    struct IsRegs : std::false_type {};
+
+    template <Utils::Reg... R>
+    struct IsRegs<Utils::Regs<R...>> : std::true_type {};
+
+    /**
+     * @brief The type a hook callback takes by reference.
+     */
+    template <typename F>
+    struct CallbackArgument : CallbackArgument<decltype(&F::operator())> {};
+
+    template <typename C, typename A>
+    struct CallbackArgument<void (C::*)(A&) const> { using type = A; };
+
+    template <typename C, typename A>
+    struct CallbackArgument<void (C::*)(A&)> { using type = A; };
+
+    template <typename A>
+    struct CallbackArgument<void (*)(A&)> { using type = A; };
+}
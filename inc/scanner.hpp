@@ -0,0 +1,733 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string_view>
+#include <span>
+#include <stdexcept>
+#include <optional>
+#include <algorithm>
+#include <bit>
+
+// Local includes
+#include "types.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Set of byte values a single pattern byte may take.
+     */
+    struct ByteSet {
+        std::array<u64, 4> bits{};
+
+        constexpr void insert(u8 value) { bits[value >> 6] |= u64(1) << (value & 63); }
+        constexpr bool contains(u8 value) const { return (bits[value >> 6] >> (value & 63)) & 1; }
+        constexpr size_t count() const
+        {
+            size_t total = 0;
+            for (u64 word : bits) {
+                total += std::popcount(word);
+            }
+            return total;
+        }
+    };
+
+    /**
+     * @brief Variable number of arbitrary bytes inside a pattern.
+     * @details Up to `extra` bytes may be inserted in front of the pattern byte at
+     *      `position`. The minimum length of a gap is part of the pattern as wildcards.
+     */
+    struct PatternGap {
+        u32 position;
+        u32 extra;
+    };
+
+    /**
+     * @brief Byte of a pattern restricted to a set of values.
+     * @details Only used when the set cannot be expressed by a byte and mask alone,
+     *      the mask of the byte then holds the bits all values have in common.
+     */
+    struct PatternSet {
+        u32 position;
+        ByteSet values;
+    };
+
+    /**
+     * @brief Captured bytes of a pattern, usually a RIP-relative displacement.
+     * @details The displacement is relative to the end of the instruction, which lies
+     *      `next` bytes behind the captured bytes.
+     */
+    struct PatternCapture {
+        u32 position;
+        u32 size;
+        u32 next;
+    };
+
+    /**
+     * @brief Non-owning byte+mask view of a compiled signature.
+     * @details Every byte of the signature occupies one slot in both spans. A mask
+     *      of `0xFF` means the byte has to match exactly, a mask of `0x00` marks a
+     *      wildcard ("??") and the corresponding entry in `bytes` is ignored. Nibble
+     *      wildcards and byte ranges that align to bits use the mask as well.
+     *
+     *      Variable gaps, byte sets and captures are optional. Scanners search for
+     *      the head, the bytes in front of the first variable gap, and only verify the
+     *      rest of the pattern where the head matches.
+     */
+    struct PatternView {
+        std::span<const u8> bytes;
+        std::span<const u8> mask;
+        std::span<const PatternGap> gaps = {};
+        std::span<const PatternSet> sets = {};
+        std::span<const PatternCapture> captures = {};
+
+        /**
+         * @brief Returns the minimum number of bytes a match spans.
+         */
+        size_t size() const { return bytes.size(); }
+
+        /**
+         * @brief Returns the maximum number of bytes a match spans.
+         */
+        size_t maxSize() const
+        {
+            size_t total = bytes.size();
+            for (const auto& gap : gaps) {
+                total += gap.extra;
+            }
+            return total;
+        }
+
+        /**
+         * @brief Returns the number of bytes in front of the first variable gap.
+         */
+        size_t head() const { return gaps.empty() ? bytes.size() : gaps[0].position; }
+
+        /**
+         * @brief Checks whether bytes and mask alone describe the pattern.
+         */
+        bool simple() const { return gaps.empty() && sets.empty(); }
+    };
+
+    /**
+     * @brief Byte+mask representation of a signature compiled at runtime.
+     */
+    struct Pattern {
+        std::vector<u8> bytes;
+        std::vector<u8> mask;
+        std::vector<PatternGap> gaps;
+        std::vector<PatternSet> sets;
+        std::vector<PatternCapture> captures;
+
+        operator PatternView() const { return { bytes, mask, gaps, sets, captures }; }
+    };
+
+    /**
+     * @brief Parses a signature into bytes, mask, gaps, sets and captures.
+     * @details Tokens are separated by spaces, every token is one of
+     *      - a two digit hex byte, "48"
+     *      - a wildcard, "?" or "??"
+     *      - a nibble wildcard, "4?" or "?8"
+     *      - a byte set of values and ranges, "48|4C" or "50-57|41"
+     *      - a gap of arbitrary bytes, "[4]" or bounded "[2-6]"
+     *
+     *      Parentheses around bytes capture them, "(?? ?? ?? ??)". A capture may be
+     *      followed by the number of instruction bytes behind it, "(?? ?? ?? ??)+1",
+     *      to resolve RIP-relative displacements. The bytes in front of the first
+     *      bounded gap need at least one exact byte, the scanners key on them.
+     *      Usable in constant expressions, where a malformed signature turns into a
+     *      compile error.
+     *
+     * @param signature Signature, e.g. `"48 8B ?? [0-2] 4? (?? ?? ?? ??)"`.
+     * @return Pattern containing the compiled signature.
+     *
+     * @throws std::invalid_argument If the signature is malformed.
+     */
+    constexpr Pattern parsePattern(std::string_view signature)
+    {
+        auto nibble = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+        auto hexByte = [&](std::string_view token) -> int {
+            if (token.size() != 2 || nibble(token[0]) < 0 || nibble(token[1]) < 0) {
+                return -1;
+            }
+            return (nibble(token[0]) << 4) | nibble(token[1]);
+        };
+        auto number = [](std::string_view token) -> u32 {
+            constexpr u32 LIMIT = 4096;
+            u32 value = 0;
+            if (token.empty()) {
+                throw std::invalid_argument("signature contains a malformed number");
+            }
+            for (char c : token) {
+                if (c < '0' || c > '9' || (value = value * 10 + (c - '0')) > LIMIT) {
+                    throw std::invalid_argument("signature contains a malformed number");
+                }
+            }
+            return value;
+        };
+
+        Pattern pattern;
+        bool open = false;
+        u32 captureStart = 0;
+        size_t pos = 0;
+        while (pos < signature.size()) {
+            if (signature[pos] == ' ') {
+                pos++;
+                continue;
+            }
+            size_t end = signature.find(' ', pos);
+            if (end == std::string_view::npos) {
+                end = signature.size();
+            }
+            std::string_view token = signature.substr(pos, end - pos);
+            pos = end;
+            u32 size = static_cast<u32>(pattern.bytes.size());
+
+            if (token.front() == '(') {
+                if (open) {
+                    throw std::invalid_argument("signature contains a nested capture");
+                }
+                open = true;
+                captureStart = size;
+                token.remove_prefix(1);
+            }
+            bool close = false;
+            u32 next = 0;
+            if (size_t paren = token.find(')'); paren != std::string_view::npos) {
+                std::string_view rest = token.substr(paren + 1);
+                if (!rest.empty()) {
+                    if (rest.front() != '+') {
+                        throw std::invalid_argument("signature contains a malformed capture");
+                    }
+                    next = number(rest.substr(1));
+                }
+                token = token.substr(0, paren);
+                close = true;
+            }
+            if (token.empty()) {
+                throw std::invalid_argument("signature contains a malformed byte");
+            }
+
+            if (token.front() == '[') {
+                if (token.back() != ']') {
+                    throw std::invalid_argument("signature contains a malformed gap");
+                }
+                std::string_view range = token.substr(1, token.size() - 2);
+                size_t dash = range.find('-');
+                u32 minimum = number(range.substr(0, dash));
+                u32 maximum = dash == std::string_view::npos ? minimum : number(range.substr(dash + 1));
+                if (minimum > maximum) {
+                    throw std::invalid_argument("signature contains a malformed gap");
+                }
+                if (maximum > minimum) {
+                    if (open) {
+                        throw std::invalid_argument("signature contains a bounded gap inside a capture");
+                    }
+                    if (size == 0) {
+                        throw std::invalid_argument("signature starts with a bounded gap");
+                    }
+                }
+                pattern.bytes.insert(pattern.bytes.end(), minimum, 0x00);
+                pattern.mask.insert(pattern.mask.end(), minimum, 0x00);
+                u32 position = size + minimum;
+                if (maximum > minimum) {
+                    if (!pattern.gaps.empty() && pattern.gaps.back().position == position) {
+                        pattern.gaps.back().extra += maximum - minimum;
+                    }
+                    else {
+                        pattern.gaps.push_back({ position, maximum - minimum });
+                    }
+                }
+            }
+            else if (token.find_first_of("|-") != std::string_view::npos) {
+                ByteSet values;
+                size_t item = 0;
+                while (item <= token.size()) {
+                    size_t bar = token.find('|', item);
+                    if (bar == std::string_view::npos) {
+                        bar = token.size();
+                    }
+                    std::string_view part = token.substr(item, bar - item);
+                    size_t dash = part.find('-');
+                    int low = hexByte(part.substr(0, dash));
+                    int high = dash == std::string_view::npos ? low : hexByte(part.substr(dash + 1));
+                    if (low < 0 || high < low) {
+                        throw std::invalid_argument("signature contains a malformed byte set");
+                    }
+                    for (int value = low; value <= high; value++) {
+                        values.insert(static_cast<u8>(value));
+                    }
+                    item = bar + 1;
+                }
+                // The bits shared by all values go into the mask, the set is only kept
+                // if the mask alone would accept more values than the set contains.
+                int first = 0;
+                while (!values.contains(static_cast<u8>(first))) {
+                    first++;
+                }
+                u8 differing = 0;
+                for (int value = first; value < 256; value++) {
+                    if (values.contains(static_cast<u8>(value))) {
+                        differing |= static_cast<u8>(value ^ first);
+                    }
+                }
+                pattern.bytes.push_back(static_cast<u8>(first & ~differing));
+                pattern.mask.push_back(static_cast<u8>(~differing));
+                if (values.count() != (size_t(1) << std::popcount(differing))) {
+                    pattern.sets.push_back({ size, values });
+                }
+            }
+            else if (token == "?" || (token.size() == 2 && (token[0] == '?' || nibble(token[0]) >= 0) &&
+                (token[1] == '?' || nibble(token[1]) >= 0))) {
+                u8 byte = 0;
+                u8 mask = 0;
+                if (token != "?") {
+                    for (char c : token) {
+                        byte <<= 4;
+                        mask <<= 4;
+                        if (c != '?') {
+                            byte |= static_cast<u8>(nibble(c));
+                            mask |= 0x0F;
+                        }
+                    }
+                }
+                pattern.bytes.push_back(byte);
+                pattern.mask.push_back(mask);
+            }
+            else {
+                throw std::invalid_argument("signature contains a malformed byte");
+            }
+
+            if (close) {
+                u32 captured = static_cast<u32>(pattern.bytes.size()) - captureStart;
+                if (!open || captured == 0) {
+                    throw std::invalid_argument("signature contains a malformed capture");
+                }
+                pattern.captures.push_back({ captureStart, captured, next });
+                open = false;
+            }
+        }
+        if (open) {
+            throw std::invalid_argument("signature contains an unclosed capture");
+        }
+        if (!pattern.gaps.empty() && pattern.gaps.back().position == pattern.bytes.size()) {
+            throw std::invalid_argument("signature ends with a bounded gap");
+        }
+        size_t head = pattern.gaps.empty() ? pattern.bytes.size() : pattern.gaps[0].position;
+        bool exact = false;
+        for (size_t i = 0; i < head; i++) {
+            exact |= (pattern.mask[i] == 0xFF);
+        }
+        if (!exact) {
+            throw std::invalid_argument("signature needs at least one non-wildcard byte in front of its gaps");
+        }
+        return pattern;
+    }
+
+    /**
+     * @brief Signature literal compiled at build time.
+     * @details Constructing a `Signature` from a string literal parses it during
+     *      compilation into fixed-size arrays, a malformed signature fails the build.
+     *      At runtime no parsing or allocation takes place, the scanner and patcher
+     *      work directly on the arrays through `view()`.
+     *
+     * @code
+     * Utils::Signature sig = "48 8B 5C 24 40    F3 0F 5F 05 (?? ?? ?? ??)";
+     * Utils::Signature bad = "48 8B 5"; // Does not compile
+     * @endcode
+     */
+    class Signature {
+    public:
+        static constexpr size_t MAX_SIZE = 64;
+        static constexpr size_t MAX_GAPS = 4;
+        static constexpr size_t MAX_SETS = 8;
+        static constexpr size_t MAX_CAPTURES = 4;
+
+        template <size_t N>
+        consteval Signature(const char (&signature)[N]) : text(signature, N - 1)
+        {
+            Pattern pattern = parsePattern(text);
+            if (pattern.bytes.size() > MAX_SIZE || pattern.gaps.size() > MAX_GAPS ||
+                pattern.sets.size() > MAX_SETS || pattern.captures.size() > MAX_CAPTURES) {
+                throw std::invalid_argument("signature is too long");
+            }
+            length = pattern.bytes.size();
+            gapCount = pattern.gaps.size();
+            setCount = pattern.sets.size();
+            captureCount = pattern.captures.size();
+            std::copy(pattern.bytes.begin(), pattern.bytes.end(), bytes.begin());
+            std::copy(pattern.mask.begin(), pattern.mask.end(), mask.begin());
+            std::copy(pattern.gaps.begin(), pattern.gaps.end(), gaps.begin());
+            std::copy(pattern.sets.begin(), pattern.sets.end(), sets.begin());
+            std::copy(pattern.captures.begin(), pattern.captures.end(), captures.begin());
+        }
+
+        /**
+         * @brief Returns the signature as it was written.
+         */
+        std::string_view str() const { return text; }
+
+        /**
+         * @brief Returns the minimum number of bytes in the signature.
+         */
+        size_t size() const { return length; }
+
+        /**
+         * @brief Returns the byte+mask view of the signature.
+         */
+        PatternView view() const
+        {
+            return {
+                { bytes.data(), length },
+                { mask.data(), length },
+                { gaps.data(), gapCount },
+                { sets.data(), setCount },
+                { captures.data(), captureCount }
+            };
+        }
+
+    private:
+        std::string_view text;
+        std::array<u8, MAX_SIZE> bytes{};
+        std::array<u8, MAX_SIZE> mask{};
+        std::array<PatternGap, MAX_GAPS> gaps{};
+        std::array<PatternSet, MAX_SETS> sets{};
+        std::array<PatternCapture, MAX_CAPTURES> captures{};
+        size_t length = 0;
+        size_t gapCount = 0;
+        size_t setCount = 0;
+        size_t captureCount = 0;
+    };
+
+    /**
+     * @brief Location of a pattern match and its captures.
+     */
+    struct PatternMatch {
+        struct Capture {
+            const u8* address;
+            u32 size;
+            u32 next;
+        };
+
+        const u8* start = nullptr;
+        size_t length = 0;
+        std::vector<Capture> captures;
+
+        /**
+         * @brief Resolves a captured 1, 2 or 4 byte displacement to its target.
+         *
+         * @param index Index of the capture in the order it appears in the signature.
+         * @return std::optional<u64> containing the target address, empty if there is
+         *      no such capture or it is not 1, 2 or 4 bytes long.
+         */
+        std::optional<u64> target(size_t index) const;
+    };
+
+    /**
+     * @brief Number of occurrences of every byte value in a sample of memory.
+     */
+    using ByteFrequency = std::array<u32, 256>;
+
+    /**
+     * @brief A pattern together with the order its bytes are best compared in.
+     * @details Most signatures start with very common opcode bytes such as 0x48 or 0xF3,
+     *      comparing them first rejects almost no candidates. The compare order lists
+     *      the non-wildcard bytes rarest first according to a byte-frequency table of the
+     *      scanned memory, the first entry acts as the anchor the scanners search for.
+     */
+    struct PreparedPattern {
+        PatternView pattern;
+        std::vector<u32> order;
+        bool anchored = false;  // order[0] is an exact byte that can be searched with memchr
+
+        PreparedPattern() = default;
+
+        /**
+         * @brief Prepares a pattern without frequency information, bytes are compared in order.
+         */
+        PreparedPattern(PatternView pattern);
+    };
+
+    /**
+     * @brief Implementations available to the signature scanner.
+     */
+    enum class ScanMode {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    /**
+     * @brief Converts an IDA-style signature into its byte+mask representation at runtime.
+     * @details Meant for signatures that are only known at runtime, signatures written
+     *      in code should use `Utils::Signature` instead. The syntax is described at
+     *      `Utils::parsePattern`.
+     *
+     * @param signature IDA-style byte array pattern, e.g. `"48 8B ?? ?? 40"`.
+     * @return Pattern holding the bytes and mask of the signature.
+     *
+     * @throws std::invalid_argument If the signature is malformed.
+     */
+    Pattern compilePattern(std::string_view signature);
+
+    /**
+     * @brief Picks the fastest scanner implementation supported by the CPU.
+     * @details Queries CPUID once, the result is cached for all subsequent calls.
+     *      AVX2 is only reported if the OS also saves the YMM registers on context
+     *      switches. SSE2 is part of the x64 baseline and always available there.
+     *
+     * @return ScanMode best suited for the running machine.
+     */
+    ScanMode detectScanMode();
+
+    /**
+     * @brief Returns a printable name for a scanner implementation.
+     *
+     * @param mode Scanner implementation.
+     * @return const char* containing the name, e.g. "AVX2".
+     */
+    const char* scanModeName(ScanMode mode);
+
+    /**
+     * @brief Builds a byte-frequency table from a sample of memory regions.
+     * @details Only the first 4 KiB of every 64 KiB are counted, which is cheap but
+     *      representative for code. Every count starts at 1.
+     *
+     * @param regions Memory regions that are going to be scanned.
+     * @return ByteFrequency of the sampled bytes.
+     */
+    ByteFrequency sampleFrequency(std::span<const std::span<const u8>> regions);
+
+    /**
+     * @brief Orders the bytes of a pattern from rarest to most common.
+     *
+     * @param pattern Compiled pattern.
+     * @param frequency Byte-frequency table of the memory that is going to be scanned.
+     * @return PreparedPattern referencing `pattern`.
+     */
+    PreparedPattern prepare(PatternView pattern, const ByteFrequency& frequency);
+
+    /**
+     * @brief Checks if a pattern matches at the start of a memory region.
+     *
+     * @param data Memory to check, a pattern longer than `data` never matches.
+     * @param pattern Compiled pattern.
+     * @return true if every non-wildcard byte matches.
+     */
+    bool matches(std::span<const u8> data, PatternView pattern);
+
+    /**
+     * @brief Matches a pattern at the start of a memory region and locates its captures.
+     * @details Bounded gaps take the fewest bytes that make the pattern match.
+     *
+     * @param data Memory to check.
+     * @param pattern Compiled pattern.
+     * @return std::optional<PatternMatch> describing the match, empty if there is none.
+     */
+    std::optional<PatternMatch> match(std::span<const u8> data, PatternView pattern);
+
+    /**
+     * @brief Scans a memory region for a pattern without SIMD.
+     * @details Reference implementation, every other scanner has to produce the exact
+     *      same results. Jumps between occurrences of the anchor byte with `memchr` and
+     *      only verifies the rest of the pattern there.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     */
+    const u8* scanScalar(std::span<const u8> region, const PreparedPattern& prepared);
+
+    /**
+     * @brief Scans a memory region for a pattern 16 positions at a time using SSE2.
+     * @details Anchored patterns skip ahead 64 positions at a time until the anchor byte
+     *      shows up, like `scanScalar` does with `memchr`.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     */
+    const u8* scanSse2(std::span<const u8> region, const PreparedPattern& prepared);
+
+    /**
+     * @brief Scans a memory region for a pattern 32 positions at a time using AVX2.
+     * @details Anchored patterns skip ahead 128 positions at a time until the anchor byte
+     *      shows up.
+     * @note Must only be called if `detectScanMode()` reports `ScanMode::Avx2`.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     */
+    const u8* scanAvx2(std::span<const u8> region, const PreparedPattern& prepared);
+
+    /**
+     * @brief Scans a memory region for a pattern using the given implementation.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @param mode Scanner implementation to use.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     */
+    const u8* scan(std::span<const u8> region, const PreparedPattern& prepared, ScanMode mode);
+
+    /**
+     * @brief Scans a memory region for a pattern using the fastest implementation.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     *
+     * @see Utils::detectScanMode
+     */
+    const u8* scan(std::span<const u8> region, const PreparedPattern& prepared);
+
+    /**
+     * @brief Streams every hit of a pattern in a memory region.
+     * @details Hits are reported in ascending order, including overlapping ones.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for.
+     * @param callback Called with every hit, returning false stops the scan.
+     */
+    template <typename Callback>
+    void scanAll(std::span<const u8> region, const PreparedPattern& prepared, Callback&& callback)
+    {
+        while (const u8* hit = scan(region, prepared)) {
+            if (!callback(hit)) {
+                return;
+            }
+            region = region.subspan(hit - region.data() + 1);
+        }
+    }
+
+    /**
+     * @brief Scans a memory region for a pattern on several threads.
+     * @details The region is split into chunks that overlap by the pattern length minus
+     *      one, so no match is lost at a chunk border. Workers pull chunks in address
+     *      order and scan them with the fastest implementation. The earliest hit wins,
+     *      once a hit is known every chunk above it is skipped.
+     *
+     * @param region Memory region to scan.
+     * @param prepared Prepared pattern to look for, ordered by a byte-frequency table
+     *      of the scanned module that the caller computes once and reuses.
+     * @param threads Maximum number of threads, 0 uses one per hardware thread.
+     * @return const u8* pointing to the first hit inside `region` or nullptr.
+     */
+    const u8* scanParallel(std::span<const u8> region, const PreparedPattern& prepared, u32 threads = 0);
+
+    /**
+     * @brief Resolves several patterns in one chunked scan of a memory region.
+     * @details The memory is split into chunks that are handed to several threads. Every
+     *      chunk is scanned for each registered pattern in turn with the anchored
+     *      single-pattern scanner, so the chunk is read from memory once and the SIMD
+     *      anchor search skips over everything that cannot start a match. This is not a
+     *      single pass: the compare work is one anchored scan per pattern and chunk, so
+     *      it grows linearly with the number of patterns. Anchors are
+     *      chosen from the byte-frequency table passed to the constructor, without one
+     *      the scanned memory is sampled once on the first scan.
+     *
+     * @code
+     * Utils::MultiScanner scanner;
+     * size_t a = scanner.add(Utils::compilePattern("80 3D ?? ?? ?? ?? 00 74 78"));
+     * size_t b = scanner.add(Utils::compilePattern("48 8B 5C 24 40 F3 0F 5F 05"));
+     * auto hits = scanner.scan(region); // hits[a] and hits[b] hold the first match or nullptr
+     * @endcode
+     */
+    class MultiScanner {
+    public:
+        /**
+         * @param threads Maximum number of threads used by `scan()`, 0 uses one per
+         *      hardware thread.
+         */
+        explicit MultiScanner(u32 threads = 0) : threads(threads) {}
+
+        /**
+         * @param frequency Byte-frequency table of the memory that is going to be
+         *      scanned, usually computed once per module.
+         * @param threads Maximum number of threads used by `scan()`, 0 uses one per
+         *      hardware thread.
+         */
+        explicit MultiScanner(const ByteFrequency& frequency, u32 threads = 0) : frequency(frequency), threads(threads) {}
+
+        /**
+         * @brief Registers a pattern.
+         *
+         * @param pattern Compiled pattern to look for, its storage has to outlive the
+         *      scanner.
+         * @return size_t containing the index of the pattern in the results of `scan()`.
+         */
+        size_t add(PatternView pattern);
+
+        /**
+         * @brief Scans a memory region for all registered patterns.
+         * @details The scan stops early once every pattern has been found.
+         *
+         * @param region Memory region to scan.
+         * @return std::vector<const u8*> containing the first hit of every pattern or
+         *      nullptr if it was not found, indexed by the value returned from `add()`.
+         */
+        std::vector<const u8*> scan(std::span<const u8> region);
+
+        /**
+         * @brief Scans several memory regions for all registered patterns.
+         * @details Regions are scanned in the given order and matches never span two
+         *      regions. The scan stops early once every pattern has been found.
+         *
+         * @param regions Memory regions to scan, ordered by address.
+         * @return std::vector<const u8*> containing the first hit of every pattern or
+         *      nullptr if it was not found, indexed by the value returned from `add()`.
+         */
+        std::vector<const u8*> scan(std::span<const std::span<const u8>> regions);
+
+        /**
+         * @brief Collects the hits of every registered pattern in one chunked scan.
+         * @details Overlapping matches of the same pattern are all reported. A pattern
+         *      stops being scanned for once its first `limits[i]` hits are known, the
+         *      scan stops early once that is the case for every pattern.
+         *
+         * @param regions Memory regions to scan, ordered by address.
+         * @param limits Maximum number of hits per pattern, indexed by the value returned
+         *      from `add()`. Patterns without an entry collect every hit.
+         * @return std::vector<std::vector<const u8*>> containing the first hits of every
+         *      pattern in ascending order, indexed by the value returned from `add()`.
+         */
+        std::vector<std::vector<const u8*>> scanAll(std::span<const std::span<const u8>> regions, std::span<const size_t> limits = {});
+
+    private:
+        void build(std::span<const std::span<const u8>> regions);
+
+        std::vector<PreparedPattern> entries;
+        std::optional<ByteFrequency> frequency;
+        u32 threads = 0;
+    };
+}
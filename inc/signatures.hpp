@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Local includes
+#include "types.hpp"
+#include "scanner.hpp"
+
+/**
+ * @brief Signatures of every fix, shared by the DLL and the offline tools.
+ * @details See the fix functions in dllmain.cpp for how each location was found.
+ */
+namespace Signatures
+{
+    struct Entry {
+        std::string_view name;
+        Utils::Signature signature;
+        u64 offset = 0;     // Offset of the hook or patch from the start of the signature
+    };
+
+    inline constexpr Entry PILLARBOX = {
+        "pillarbox",
+        "80 3D ?? ?? ?? ?? 00    74 78    F3 0F 10 44 24 60",
+        6
+    };
+
+    inline constexpr Entry FOV = {
+        "fov",
+        "F3 0F 11 44 24 20    E8 ?? ?? ?? ??    48 8B 5C 24 50    48 83 C4 40    5F    C3    48 89 5C 24 08"
+    };
+
+    inline constexpr Entry HUD = {
+        "hud",
+        "48 8B 5C 24 40    F3 0F 5F 05 ?? ?? ?? ??"
+    };
+
+    inline constexpr std::array ALL = { PILLARBOX, FOV, HUD };
+}
@@ -0,0 +1,140 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <span>
+#include <cstdint>
+
+// Local includes
+#include "types.hpp"
+#include "scanner.hpp"
+#include "image.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Suffix array over a byte string.
+     * @details Built with SA-IS in O(n) time. Every substring of the text then
+     *      corresponds to one contiguous interval of the array, which is found by
+     *      binary search in O(m log n) for a needle of length m.
+     */
+    class SuffixArray {
+    public:
+        SuffixArray() = default;
+
+        /**
+         * @brief Builds the suffix array of a text.
+         *
+         * @param text Text to index, has to outlive the suffix array and be smaller
+         *      than 2 GiB.
+         */
+        explicit SuffixArray(std::span<const u8> text);
+
+        /**
+         * @brief Restores a suffix array that was built before.
+         *
+         * @param text Text the suffixes were built from.
+         * @param suffixes Previously built suffix array of `text`.
+         */
+        SuffixArray(std::span<const u8> text, std::vector<u32> suffixes);
+
+        /**
+         * @brief Finds every occurrence of an exact byte string.
+         *
+         * @param needle Bytes to look for, must not be empty.
+         * @return std::span<const u32> containing the start of every occurrence in no
+         *      particular order.
+         */
+        std::span<const u32> find(std::span<const u8> needle) const;
+
+        std::span<const u32> suffixes() const { return sa; }
+        std::span<const u8> text() const { return data; }
+
+    private:
+        std::span<const u8> data;
+        std::vector<u32> sa;
+    };
+
+    /**
+     * @brief Suffix array over the executable sections of an image file.
+     * @details Meant for offline tooling that resolves many signatures against the
+     *      same build. Building costs a few seconds for a large image, afterwards each
+     *      query costs O(m log n) instead of a pass over the whole code. Signatures with
+     *      wildcards are looked up by their most selective run of exact bytes, every
+     *      candidate is then verified against the full signature.
+     *
+     *      The array can be stored next to the executable, it is only reused for the
+     *      exact same build.
+     */
+    class CodeIndex {
+    public:
+        /**
+         * @brief Indexes the executable sections of an image.
+         *
+         * @param image Image to index, has to outlive the index.
+         * @param cachePath File to load the suffix array from, or to store it in if
+         *      it is missing or stale. Empty disables caching.
+         */
+        explicit CodeIndex(const ImageFile& image, const std::string& cachePath = "");
+        CodeIndex(const CodeIndex&) = delete;
+        CodeIndex& operator=(const CodeIndex&) = delete;
+
+        /**
+         * @brief Finds every occurrence of a signature.
+         * @details Candidates are verified in suffix-array order, not by address. A
+         *      limited result is therefore an arbitrary subset of the hits, only good for
+         *      counting, e.g. `limit = 2` to check for uniqueness. Its first element is
+         *      only the lowest hit if it is the only one.
+         *
+         * @param pattern Compiled pattern, needs at least one exact byte.
+         * @param limit Stop after this many hits, e.g. 2 to check for uniqueness.
+         * @return std::vector<u32> containing the RVA of every hit found in ascending order.
+         */
+        std::vector<u32> find(PatternView pattern, size_t limit = SIZE_MAX) const;
+
+        /**
+         * @return true if the suffix array was loaded from the cache file.
+         */
+        bool cached() const { return loaded; }
+
+    private:
+        struct Segment {
+            u32 offset;     // Offset into `text`
+            u32 rva;
+            u32 size;
+        };
+
+        bool load(const std::string& path);
+        bool save(const std::string& path) const;
+
+        const ImageFile& image;
+        std::vector<u8> text;
+        std::vector<Segment> segments;
+        SuffixArray array;
+        bool loaded = false;
+    };
+}
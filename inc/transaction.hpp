@@ -0,0 +1,191 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <vector>
+#include <string>
+#include <span>
+#include <utility>
+
+// Local includes
+#include "types.hpp"
+#include "scanner.hpp"
+
+namespace Utils
+{
+    /**
+     * @brief Suspends every other thread of the process for its lifetime.
+     * @details The thread list is gathered before the first thread is suspended, so
+     *      nothing is allocated while a suspended thread might hold the heap lock.
+     *      Code running while threads are frozen must not allocate or log either.
+     *      The instruction pointer of every thread is read once it has stopped.
+     */
+    class ThreadFreezer {
+    public:
+        ThreadFreezer();
+        ~ThreadFreezer();
+
+        ThreadFreezer(const ThreadFreezer&) = delete;
+        ThreadFreezer& operator=(const ThreadFreezer&) = delete;
+
+        struct Thread {
+            HANDLE handle;
+            u64 ip;     // Where the thread was suspended
+        };
+
+        /**
+         * @brief Returns the suspended threads.
+         */
+        const std::vector<Thread>& frozen() const { return threads; }
+
+    private:
+        std::vector<Thread> threads;
+    };
+
+    /**
+     * @brief Applies a batch of code patches at once and can undo them.
+     * @details Writes are only collected by `add()`. `commit()` then groups them by
+     *      memory page and, with all other threads frozen once, makes every affected
+     *      run of pages writable, writes all patches, restores the protection of each
+     *      run and flushes the instruction cache once for the whole batch. The bytes
+     *      that were overwritten are kept, `rollback()` writes them back the same way.
+     *
+     *      Before anything is written the instruction pointer of every frozen thread
+     *      is checked against all patched ranges together. A thread stopped inside a
+     *      patch, past its first byte, would resume in the middle of an instruction.
+     *      It is moved if a `redirect()` covers it, otherwise the threads are resumed
+     *      for a moment and frozen again.
+     *
+     *      One bad patch does not cost the others: overlapping patches, and patches
+     *      that threads are still inside of after the last attempt, are logged by name
+     *      and dropped while the rest is written. `written()` tells which survived.
+     *
+     * @code
+     * Utils::PatchTransaction transaction;
+     * transaction.add(first, Utils::Signature("01").view());
+     * transaction.add(second, Utils::Signature("90 90").view());
+     * transaction.commit();
+     * @endcode
+     */
+    class PatchTransaction {
+    public:
+        /**
+         * @brief Queues a patch.
+         * @details Wildcard bytes and bits of the pattern are left untouched. Bounded
+         *      gaps and byte sets have no meaning for a patch.
+         *
+         * @param address Address to patch.
+         * @param pattern Compiled byte+mask pattern to write.
+         * @param name Description of the patch for the log if it is dropped.
+         * @return true if the patch was queued, false if the pattern is not a plain
+         *      byte+mask pattern or the transaction was already committed.
+         */
+        bool add(u64 address, Utils::PatternView pattern, std::string name = "");
+
+        /**
+         * @brief Queues a patch that overwrites every byte.
+         *
+         * @param address Address to patch.
+         * @param bytes Bytes to write.
+         * @param name Description of the patch for the log if it is dropped.
+         * @return true if the patch was queued, false if the transaction was already
+         *      committed.
+         */
+        bool add(u64 address, std::span<const u8> bytes, std::string name = "");
+
+        /**
+         * @brief Moves threads that are stopped at an address when the patches are written.
+         * @details Used when a patch displaces instructions to a code cave, a thread
+         *      suspended in the middle of them continues at their copy instead.
+         *
+         * @param from Instruction pointer to move.
+         * @param to Instruction pointer to move it to.
+         */
+        void redirect(u64 from, u64 to) { redirects.emplace_back(from, to); }
+
+        /**
+         * @brief Adds code written outside of the transaction to the instruction cache flush.
+         * @details Used for code caves, they are written before the jumps to them and
+         *      flushed together with the patches.
+         *
+         * @param address Start of the code.
+         * @param size Size of the code in bytes.
+         */
+        void flush(u64 address, size_t size) { extra.emplace_back(address, size); }
+
+        /**
+         * @brief Writes all queued patches.
+         * @details Overlapping patches and patches that threads keep running inside of
+         *      are dropped, see `written()`. Nothing is written if a page cannot be made
+         *      writable, protections changed up to that point are restored.
+         *
+         * @return true if the patches that were not dropped were written.
+         */
+        bool commit();
+
+        /**
+         * @brief Checks whether the patch queued at an address was written by `commit()`.
+         */
+        bool written(u64 address) const;
+
+        /**
+         * @brief Restores the bytes overwritten by `commit()`.
+         *
+         * @return true if the original bytes were written back.
+         */
+        bool rollback();
+
+        /**
+         * @brief Returns the number of queued patches.
+         */
+        size_t size() const { return writes.size(); }
+
+        /**
+         * @brief Checks whether the patches are currently applied.
+         */
+        bool committed() const { return applied; }
+
+    private:
+        struct Write {
+            u64 address;
+            std::string name;
+            std::vector<u8> patched;
+            std::vector<u8> original;
+        };
+
+        bool write(bool patch);
+        void drop(const std::vector<bool>& rejected);
+        void coalesce();
+        size_t owner(u64 address) const;
+        size_t interrupted(const ThreadFreezer& freezer, bool patch, std::vector<bool>& busy) const;
+
+        std::vector<Write> writes;
+        std::vector<std::pair<u64, size_t>> pages;  // Runs of pages, address and size
+        std::vector<std::pair<u64, u64>> redirects;
+        std::vector<std::pair<u64, size_t>> extra;  // Code to flush besides the pages
+        bool applied = false;
+    };
+}
@@ -36,21 +36,17 @@
 #include "yaml-cpp/yaml.h"
 #include "safetyhook.hpp"
 
-#define LOG(STRING, ...) spdlog::info("{} : " STRING, __func__, ##__VA_ARGS__)
+// Local includes
+#include "types.hpp"
+#include "scanner.hpp"
+#include "pe.hpp"
+#include "instructions.hpp"
+#include "transaction.hpp"
+#include "cave.hpp"
+#include "regs.hpp"
+#include "hooks.hpp"
 
-namespace
-{
-    typedef uint8_t  u8;
-    typedef uint16_t u16;
-    typedef uint32_t u32;
-    typedef uint64_t u64;
-    typedef int8_t   i8;
-    typedef int16_t  i16;
-    typedef int32_t  i32;
-    typedef int64_t  i64;
-    typedef float    f32;
-    typedef double   f64;
-}
+#define LOG(STRING, ...) spdlog::info("{} : " STRING, __func__, ##__VA_ARGS__)
 
 namespace Utils
 {
@@ -59,18 +55,57 @@ namespace Utils
         HMODULE address;
         std::string name = "";
         ModuleInfo(HMODULE address) : address(address) {}
+        ModuleInfo(HMODULE address, std::string name) : address(address), name(std::move(name)) {}
+    };
+
+    /**
+     * @brief Module name that makes a hook or patch search every loaded module.
+     */
+    inline const std::string ANY_MODULE = "*";
+
+    /**
+     * @brief Where the hits of a signature are accepted, based on the .pdata function index.
+     */
+    enum class Scope {
+        Anywhere,       // Any hit inside the scanned section
+        Function,       // The whole match has to lie inside one function
+        FunctionStart   // The match has to start at the first byte of a function
+    };
+
+    struct HookFallback {
+        Utils::Signature signature;
+        u64 offset = 0;
+        u32 match = 0;
     };
 
     struct SignatureHook {
-        std::string signature;
+        Utils::Signature signature;
         u64 offset = 0;
+        std::string module = "";    // Module to scan by file name, empty scans the module passed in, ANY_MODULE scans all
+        std::string section = "";   // Section to scan, empty scans all executable sections
+        u32 match = 0;              // Index of the hit to use when the signature matches more than once
+        bool unique = false;        // Skip the hook if the signature matches more than once
+        Utils::Scope scope = Utils::Scope::Anywhere;
+        std::vector<HookFallback> fallbacks = {};   // Used in order when `signature` is not found
+    };
+
+    struct PatchFallback {
+        Utils::Signature signature;
+        u64 patchOffset = 0;
+        u32 match = 0;
     };
 
     struct SignaturePatch {
-        std::string signature;
+        Utils::Signature signature;
         u64 signatureOffset = 0;
-        std::string patch;
+        Utils::Signature patch;
         u64 patchOffset = 0;
+        std::string module = "";    // Module to scan by file name, empty scans the module passed in, ANY_MODULE scans all
+        std::string section = "";   // Section to scan, empty scans all executable sections
+        u32 match = 0;              // Index of the hit to use when the signature matches more than once
+        bool unique = false;        // Skip the patch if the signature matches more than once
+        Utils::Scope scope = Utils::Scope::Anywhere;
+        std::vector<PatchFallback> fallbacks = {};  // Used in order when `signature` is not found
     };
 
     /**
@@ -119,31 +154,151 @@ namespace Utils
 
     /**
      * @brief Patch an area of memory with a pattern.
-     * @details Overwrites memory at `address` using the provided pattern. The `pattern`
-     *      must be formatted as a space-separated hex string (e.g., `"DE AD BE EF"`).
-     *      The function modifies memory at the specified address, spanning the number
-     *      of bytes determined by the pattern length. Proper care should be taken to
-     *      avoid segmentation faults or corruption of unintended memory regions.
+     * @details Overwrites memory at `address` using the provided pattern, e.g. a
+     *      `Utils::Signature` written as `"DE AD ?? EF"`. The function modifies memory
+     *      at the specified address, spanning the number of bytes determined by the
+     *      pattern length. Wildcard bytes and bits are left untouched. Bounded gaps and
+     *      byte sets have no meaning for a patch, such patterns are rejected. Proper care
+     *      should be taken to avoid segmentation faults or corruption of unintended memory
+     *      regions. Several patches are better applied together with a
+     *      `Utils::PatchTransaction`.
      *
      * @param address Memory address to patch.
-     * @param pattern IDA-style byte array pattern.
+     * @param pattern Compiled byte+mask pattern.
      */
-    void patch(u64 address, std::string& pattern);
+    void patch(u64 address, Utils::PatternView pattern);
+
+    /**
+     * @brief Collects the memory regions of a module that are safe to scan.
+     * @details Walks the section table of the module and keeps the sections selected
+     *      by `section`. The selected sections are then checked with `VirtualQuery`,
+     *      uncommitted, inaccessible and guard pages are dropped so scanning them can
+     *      never fault. Adjacent readable pages are merged into one region. The parsed
+     *      headers and the regions of every section are cached per module, so later
+     *      calls neither parse the headers nor query the pages again.
+     *
+     * @param module Base address of the module.
+     * @param section Name of the section to use, e.g. ".rdata". If empty all sections
+     *      flagged with `IMAGE_SCN_MEM_EXECUTE` are used.
+     * @return std::vector<std::span<const u8>> containing the readable regions ordered
+     *      by address.
+     */
+    std::vector<std::span<const u8>> scanRegions(void* module, const std::string& section = "");
 
     /**
      * @brief Scan for a given byte pattern in a module.
-     * @details Searches the specified module's memory for occurrences of the given
-     *      IDA-style byte pattern. Each match is appended to the `address` vector.
-     *      Wildcard bytes ("??") can be used to match any byte in the pattern.
+     * @details Searches the specified module's memory for the first occurrence of the
+     *      given IDA-style byte pattern. Wildcard bytes ("??") can be used to match any
+     *      byte in the pattern. The scan is spread over all hardware threads and uses
+     *      the fastest implementation supported by the CPU.
      *
      * @param module Base address of the module to scan.
-     * @param signature IDA-style byte array pattern.
-     * @param address Vector to store found addresses.
+     * @param signature Compiled byte+mask pattern.
+     * @param section Section to scan, empty scans all executable sections.
      *
      * @return uintptr_t containing the address of the first hit if the signature is
      *      found else 0.
      */
-    uintptr_t patternScan(void* module, std::string& signature);
+    uintptr_t patternScan(void* module, Utils::PatternView signature, const std::string& section = "");
+
+    /**
+     * @brief Scan for every occurrence of a byte pattern in a module.
+     * @details Useful to check whether a signature is unique, or to pick a specific
+     *      hit of a signature that matches several times.
+     *
+     * @param module Base address of the module to scan.
+     * @param signature Compiled byte+mask pattern.
+     * @param section Section to scan, empty scans all executable sections.
+     *
+     * @return std::vector<u64> containing the address of every hit in ascending order.
+     */
+    std::vector<u64> patternScanAll(void* module, Utils::PatternView signature, const std::string& section = "");
+
+    /**
+     * @brief Scan for an instruction sequence in a module.
+     * @details Matches against the decoded instructions of the module instead of its
+     *      raw bytes, so a signature such as `"movss mem, xmm?; call imm"` keeps working
+     *      when the compiler picks other registers or displacements. The module is
+     *      decoded once, on first use, and the index is reused by later calls.
+     *
+     * @param module Base address of the module to scan.
+     * @param pattern Instruction sequence, see `Utils::compileInstructionPattern`.
+     *
+     * @return std::vector<u64> containing the address of every hit in ascending order.
+     *
+     * @see Utils::InstructionIndex
+     */
+    std::vector<u64> instructionScan(void* module, const Utils::InstructionPattern& pattern);
+
+    /**
+     * @brief Finds the instructions of a module that refer to an address.
+     * @details Covers RIP-relative operands, e.g. `maxss xmm0,[TQ2-Win64-Shipping.exe+826A4C5]`,
+     *      as well as relative calls and jumps. Answered from the instruction index
+     *      of the module in O(log n).
+     *
+     * @param module Base address of the module.
+     * @param address Absolute address that is referred to.
+     *
+     * @return std::vector<u64> containing the address of every referring instruction.
+     */
+    std::vector<u64> referencesTo(void* module, u64 address);
+
+    /**
+     * @brief Finds the instructions of a module that use a 32-bit immediate.
+     * @details E.g. the 16:9 aspect ratio in `mov [rax+2B0],3FE38E39`. Answered from the
+     *      instruction index of the module in O(log n).
+     *
+     * @param module Base address of the module.
+     * @param value Immediate to look for.
+     *
+     * @return std::vector<u64> containing the address of every instruction using it.
+     */
+    std::vector<u64> constantUses(void* module, u32 value);
+
+    /**
+     * @brief Scan for several byte patterns in a module at once.
+     * @details The module's memory is walked chunk by chunk once, every chunk is
+     *      scanned for each signature in turn while it is still in cache. Memory traffic
+     *      stays the same, the compare work grows linearly with the number of signatures.
+     *
+     * @param module Base address of the module to scan.
+     * @param signatures Compiled byte+mask patterns.
+     * @param section Section to scan, empty scans all executable sections.
+     *
+     * @return std::vector<u64> containing the address of the first hit of every
+     *      signature, in the same order as `signatures`, or 0 if it was not found.
+     *
+     * @see Utils::MultiScanner
+     */
+    std::vector<u64> patternScan(void* module, std::span<const Utils::PatternView> signatures, const std::string& section = "");
+
+    /**
+     * @brief Lists the modules loaded into the process.
+     * @details Enumerated through `EnumProcessModules`, the executable comes first and
+     *      the other modules follow in load order.
+     *
+     * @return std::vector<Utils::ModuleInfo> containing the address and file name of
+     *      every module.
+     */
+    std::vector<Utils::ModuleInfo> enumerateModules();
+
+    /**
+     * @brief Queues a mid-function hook for `Utils::applyInjections`.
+     *
+     * @param module The module to scan for the signature.
+     * @param hook Struct containing the signature and hook information.
+     * @param callback The function to execute when the hook is triggered.
+     */
+    void queueHook(Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::HookCallback& callback);
+
+    /**
+     * @brief Queues a code cave for `Utils::applyInjections`.
+     *
+     * @param module The module to scan for the signature.
+     * @param hook Struct containing the signature and hook information.
+     * @param code The instructions to run when the hooked site is reached.
+     */
+    void queueCave(Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::CaveCode& code);
 
     /**
      * @brief Injects a mid-function hook based on the provided signature to scan for.
@@ -152,41 +307,59 @@ namespace Utils
      * @param enable If true, the hook will be injected; otherwise, it is skipped.
      * @param module The module to scan for the signature.
      * @param hook Struct containing the signature and hook information.
-     * @param callback The function to execute when the hook is triggered.
+     * @param callback The function to execute when the hook is triggered, must not
+     *      capture anything. It takes either a `SafetyHookContext&` or a
+     *      `Utils::Regs<...>&`.
      *
      * @details
-     * This function scans the specified module for the given signature pattern.
-     * If a match is found, it calculates the absolute and relative addresses,
-     * logs the location, and applies a mid-function hook at the computed address.
+     * The hook is only queued here, the module is scanned and the hook is applied
+     * once `Utils::applyInjections` is called. This allows the signatures of all
+     * fixes to be resolved in one shared, chunked scan of the module.
      *
-     * @note This function only hooks the first match found in the module.
+     * Every hooked address gets one stub in a code cave, shared by all callbacks
+     * that hook it, see `Utils::HookSite`. A callback taking `Utils::Regs` only
+     * needs the registers listed in `Utils::Regs` saved, besides the ones the call
+     * itself may clobber. A callback taking `SafetyHookContext&` needs all of them.
      *
-     * @see Utils::patternScan
+     * @note Only one match is hooked, the first one unless `hook.match` says
+     *      otherwise. Ambiguous signatures are logged. If `hook.signature` is not
+     *      found the first of `hook.fallbacks` that is found is used instead.
+     *
+     * @see Utils::applyInjections
      */
     template <typename Func>
     void injectHook(bool enable, Utils::ModuleInfo& module, Utils::SignatureHook& hook, Func&& callback) {
         LOG("Fix {}", enable ? "Enabled" : "Disabled");
         if (enable) {
-            u64 addr = Utils::patternScan(module.address, hook.signature);
-            if (addr != 0) {
-                u64 hit = addr;
-                u64 absAddr = hit;
-                u64 relAddr = hit - reinterpret_cast<u64>(module.address);
-                LOG("Found '{}' @ {:s}+{:x}", hook.signature, module.name, relAddr);
-                u64 hookAbsAddr = absAddr + hook.offset;
-                u64 hookRelAddr = relAddr + hook.offset;
-                static SafetyHookMid aspectRatioHook = safetyhook::create_mid(
-                    reinterpret_cast<void*>(hookAbsAddr),
-                    callback
-                );
-                LOG("Hooked @ {:s}+{:x}", module.name, hookRelAddr);
+            using Argument = typename Utils::CallbackArgument<std::decay_t<Func>>::type;
+            if constexpr (Utils::IsRegs<Argument>::value) {
+                Utils::queueHook(module, hook, Argument::wrap(+callback));
             }
             else {
-                LOG("Did not find '{}'", hook.signature);
+                Utils::queueHook(module, hook, Utils::wrapContext(+callback));
             }
         }
     }
 
+    /**
+     * @brief Injects native code based on the provided signature to scan for.
+     *
+     * @param enable If true, the code will be injected; otherwise, it is skipped.
+     * @param module The module to scan for the signature.
+     * @param hook Struct containing the signature and hook information.
+     * @param code The instructions to run when the hooked site is reached.
+     *
+     * @details
+     * Unlike `injectHook` no registers are saved, the site jumps to a code cave that
+     * runs `code`, the instructions displaced by the jump and then jumps back. Meant
+     * for hot paths where the cost of a mid-function hook matters. Queued and
+     * resolved the same way as `injectHook`.
+     *
+     * @see Utils::CaveCode
+     * @see Utils::applyInjections
+     */
+    void injectCave(bool enable, Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::CaveCode& code);
+
     /**
      * @brief Patches bytes based on the provided signature to scan for.
      *
@@ -195,15 +368,79 @@ namespace Utils
      * @param sp Struct containing the signature and patch information.
      *
      * @details
-     * This function scans the specified module for the given signature pattern.
-     * If a match is found, it calculates the absolute and relative addresses,
-     * logs the location, and applies a patch at the computed address based on the
-     * information provided in the `patch` struct.
+     * The patch is only queued here, the module is scanned and the patch is applied
+     * once `Utils::applyInjections` is called. This allows the signatures of all
+     * fixes to be resolved in one shared, chunked scan of the module.
+     *
+     * @note Only one match is patched, the first one unless `sp.match` says
+     *      otherwise. Ambiguous signatures are logged. If `sp.signature` is not
+     *      found the first of `sp.fallbacks` that is found is used instead.
+     *
+     * @see Utils::applyInjections
+     */
+    void injectPatch(bool enable, Utils::ModuleInfo& module, Utils::SignaturePatch& sp);
+
+    /**
+     * @brief Resolves and applies all queued hooks and patches.
+     *
+     * @details
+     * Every module that has pending hooks or patches is scanned once for all of
+     * their signatures, signatures that target the same section share one scan.
+     * A hook or patch is searched in the module passed to `injectHook` or
+     * `injectPatch`, unless its `module` names another loaded module. With
+     * `Utils::ANY_MODULE` every loaded module is searched and the first module in
+     * load order in which the signature is accepted is used. The sections of all
+     * modules are scanned concurrently by at most one thread per hardware thread.
+     * For every match the absolute and relative addresses are calculated, the
+     * location is logged and the hook or patch is applied at the computed address.
+     *
+     * If `cachePath` is given, the RVAs found are remembered on disk for the current
+     * build of each module. On the next launch a cached RVA is used without scanning,
+     * as long as the signature still matches at that RVA.
+     *
+     * Hits outside of the `scope` of a signature are dropped before `match` is
+     * applied. Signatures scoped to the start of a function are only compared at
+     * the function starts listed in .pdata instead of being scanned for, and if every
+     * signature of a section is scoped the padding and data between functions is
+     * not scanned.
      *
-     * @note This function only patches the first match found in the module.
+     * Fallback signatures are resolved in the same scan as the primary signature,
+     * the first alternative that is found wins.
      *
+     * Hooks that resolve to the same address share one `Utils::HookSite`, their
+     * callbacks run in the order they were injected. Hooks on an address hooked by
+     * an earlier call are added to its site.
+     *
+     * Signatures that match more than once are logged together with the number of
+     * hits, the hit selected by `match` is used unless `unique` is set. Signatures
+     * that could not be found, or are ambiguous while `unique` is set, are logged and
+     * skipped.
+     *
+     * All patches, code caves and hooks are staged first and written in one
+     * `Utils::PatchTransaction`. Threads are suspended and resumed once, every page
+     * is unprotected once no matter how many patches it holds and the instruction
+     * cache is flushed once for all of them. A patch or hook that overlaps another
+     * one, or that threads keep running inside of, is logged and skipped without
+     * affecting the others.
+     *
+     * @param cachePath Path of the signature cache file, empty disables the cache.
+     *
+     * @see Utils::SignatureCache
      * @see Utils::patternScan
      * @see Utils::patch
      */
-    void injectPatch(bool enable, Utils::ModuleInfo& module, Utils::SignaturePatch& sp);
+    void applyInjections(const std::string& cachePath = "");
+
+    /**
+     * @brief Restores the bytes overwritten by the patches of `Utils::applyInjections`.
+     */
+    void revertPatches();
+
+    /**
+     * @brief Looks up the hook installed at an address by `Utils::applyInjections`.
+     *
+     * @param address Absolute address of the hook.
+     * @return Utils::HookSite* the site, or nullptr if the address is not hooked.
+     */
+    Utils::HookSite* findHookSite(u64 address);
 }
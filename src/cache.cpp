@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "cache.hpp"
+
+namespace
+{
+    bool sameBuild(const Utils::CacheKey& a, const Utils::CacheKey& b)
+    {
+        return a.timeDateStamp == b.timeDateStamp && a.checkSum == b.checkSum && a.sizeOfImage == b.sizeOfImage;
+    }
+}
+
+namespace Utils
+{
+    void SignatureCache::load(const std::string& path)
+    {
+        entries.clear();
+        builds.clear();
+        dirty = false;
+
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream stream(line);
+            Entry entry{};
+            stream >> std::hex >> entry.key.timeDateStamp >> entry.key.checkSum >> entry.key.sizeOfImage
+                >> entry.key.signatureHash >> entry.rva;
+            if (stream) {
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    bool SignatureCache::save(const std::string& path)
+    {
+        // Entries of builds that are no longer installed would otherwise pile up with
+        // every game update.
+        auto stale = std::erase_if(entries, [this](const Entry& entry) {
+            return std::none_of(builds.begin(), builds.end(), [&entry](const CacheKey& build) {
+                return sameBuild(build, entry.key);
+            });
+        });
+        dirty |= (stale != 0);
+        if (!dirty) {
+            return true;
+        }
+
+        std::ofstream file(path, std::ios::trunc);
+        for (const auto& entry : entries) {
+            file << std::hex << entry.key.timeDateStamp << ' ' << entry.key.checkSum << ' '
+                << entry.key.sizeOfImage << ' ' << entry.key.signatureHash << ' ' << entry.rva << '\n';
+        }
+        dirty = !file.good();
+        return !dirty;
+    }
+
+    std::optional<u32> SignatureCache::find(const CacheKey& key) const
+    {
+        touch(key);
+        auto it = std::find_if(entries.begin(), entries.end(), [&key](const Entry& entry) {
+            return entry.key == key;
+        });
+        if (it == entries.end()) {
+            return std::nullopt;
+        }
+        return it->rva;
+    }
+
+    void SignatureCache::store(const CacheKey& key, u32 rva)
+    {
+        touch(key);
+        auto it = std::find_if(entries.begin(), entries.end(), [&key](const Entry& entry) {
+            return entry.key == key;
+        });
+        if (it == entries.end()) {
+            entries.push_back({ key, rva });
+            dirty = true;
+        }
+        else if (it->rva != rva) {
+            it->rva = rva;
+            dirty = true;
+        }
+    }
+
+    void SignatureCache::touch(const CacheKey& key) const
+    {
+        if (std::none_of(builds.begin(), builds.end(), [&key](const CacheKey& build) { return sameBuild(build, key); })) {
+            builds.push_back(key);
+        }
+    }
+
+    void SignatureCache::erase(const CacheKey& key)
+    {
+        auto count = std::erase_if(entries, [&key](const Entry& entry) {
+            return entry.key == key;
+        });
+        dirty |= (count != 0);
+    }
+}
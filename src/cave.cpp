@@ -0,0 +1,375 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <windows.h>
+#include <vector>
+#include <span>
+#include <cstring>
+#include <algorithm>
+
+#include "cave.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    constexpr size_t JUMP_SIZE = 5;             // jmp rel32
+    constexpr u64 REACH = 0x7FFF0000;           // Just under the 2 GiB a rel32 can span, see `reaches()`
+
+    /**
+     * @brief Executable memory shared by the caves close to one another.
+     */
+    struct CaveRegion {
+        u64 base;
+        size_t size;
+        size_t used;
+        size_t sealed;  // Pages below are execute-read, the ones above still read-write
+        std::vector<std::pair<u64, size_t>> holes;  // Caves given back by `Cave::release`
+    };
+
+    std::vector<CaveRegion> regions;
+
+    /**
+     * @brief Checks whether a cave can use rel32 operands for everything it refers to.
+     * @details The jump at the site has to reach the cave, and every relocated branch
+     *      or RIP-relative operand has to reach its target from inside the cave. Those
+     *      targets may be up to 2 GiB away from the site in either direction, so being
+     *      close to the site alone is not enough.
+     *
+     * @param address Start of the cave.
+     * @param size Size of the cave.
+     * @param targets Site of the cave and the absolute targets of its relocated operands.
+     * @return true if every target is within `REACH` of every byte of the cave.
+     */
+    bool reaches(u64 address, size_t size, std::span<const u64> targets)
+    {
+        for (u64 target : targets) {
+            if (std::max(address + size, target) - std::min(address, target) >= REACH) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Allocates executable memory that `reaches()` the site and all targets.
+     * @details Caves are carved out of regions of one allocation granule, space given
+     *      back by released caves is reused first. Otherwise the free ranges closest to
+     *      the site are tried, above it and then below it.
+     *      The memory is committed read-write, see `store()`.
+     */
+    u64 allocateNear(u64 site, size_t size, std::span<const u64> targets)
+    {
+        for (auto& region : regions) {
+            for (auto& [start, length] : region.holes) {
+                if (length >= size && reaches(start, size, targets)) {
+                    u64 address = start;
+                    size_t taken = std::min(length, (size + 15) & ~size_t(15));
+                    start += taken;
+                    length -= taken;
+                    return address;
+                }
+            }
+        }
+        for (auto& region : regions) {
+            u64 start = (region.base + region.used + 15) & ~u64(15);
+            if (start + size <= region.base + region.size && reaches(start, size, targets)) {
+                region.used = static_cast<size_t>(start + size - region.base);
+                return start;
+            }
+        }
+
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        u64 granularity = info.dwAllocationGranularity;
+        size_t length = static_cast<size_t>((size + granularity - 1) & ~(granularity - 1));
+        auto reserve = [&](u64 address) -> u64 {
+            if (!reaches(address, size, targets)) {
+                return 0;
+            }
+            void* memory = VirtualAlloc(reinterpret_cast<LPVOID>(address), length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (memory == nullptr) {
+                return 0;
+            }
+            regions.push_back({ reinterpret_cast<u64>(memory), length, size, 0, {} });
+            return reinterpret_cast<u64>(memory);
+        };
+
+        MEMORY_BASIC_INFORMATION memory{};
+        u64 high = site + REACH - length;
+        for (u64 address = (site + granularity - 1) & ~(granularity - 1); address < high;) {
+            if (VirtualQuery(reinterpret_cast<LPCVOID>(address), &memory, sizeof(memory)) == 0) {
+                break;
+            }
+            if (memory.State == MEM_FREE) {
+                if (u64 allocated = reserve(address)) {
+                    return allocated;
+                }
+                // A target far above the site may only be reached further up this range.
+                address += granularity;
+                continue;
+            }
+            u64 next = reinterpret_cast<u64>(memory.BaseAddress) + memory.RegionSize;
+            address = std::max(address + granularity, (next + granularity - 1) & ~(granularity - 1));
+        }
+
+        u64 low = site > REACH ? site - REACH : granularity;
+        for (u64 address = (site & ~(granularity - 1)) - granularity; address > low;) {
+            if (VirtualQuery(reinterpret_cast<LPCVOID>(address), &memory, sizeof(memory)) == 0) {
+                break;
+            }
+            if (memory.State == MEM_FREE) {
+                if (u64 allocated = reserve(address)) {
+                    return allocated;
+                }
+                address -= granularity;
+            }
+            else {
+                u64 base = reinterpret_cast<u64>(memory.AllocationBase) & ~(granularity - 1);
+                address = std::min(address, base) - granularity;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Writes a cave into its region and makes its pages execute-read.
+     * @details Pages that already hold an earlier cave, which may be running, are only
+     *      unlocked while the cave is written. All other pages of the cave are still
+     *      read-write from the allocation.
+     *
+     * @param address Start of the cave, returned by `allocateNear()`.
+     * @param code Instructions of the cave.
+     * @param dataOffset Offset of the constants from `address`.
+     * @param data Constants of the cave.
+     * @return true if the cave was written and sealed.
+     */
+    bool store(u64 address, std::span<const u8> code, size_t dataOffset, std::span<const u8> data)
+    {
+        auto region = std::find_if(regions.begin(), regions.end(), [address](const CaveRegion& region) {
+            return address >= region.base && address < region.base + region.size;
+        });
+        if (region == regions.end()) {
+            return false;
+        }
+
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        u64 pageSize = info.dwPageSize;
+        u64 first = address & ~(pageSize - 1);
+        u64 end = (address + dataOffset + data.size() + pageSize - 1) & ~(pageSize - 1);
+        u64 sealed = std::min(end, region->base + region->sealed);
+        DWORD protection;
+        if (first < sealed &&
+            !VirtualProtect(reinterpret_cast<LPVOID>(first), static_cast<SIZE_T>(sealed - first), PAGE_EXECUTE_READWRITE, &protection)) {
+            return false;
+        }
+        std::memcpy(reinterpret_cast<void*>(address), code.data(), code.size());
+        std::memcpy(reinterpret_cast<void*>(address + dataOffset), data.data(), data.size());
+        if (!VirtualProtect(reinterpret_cast<LPVOID>(first), static_cast<SIZE_T>(end - first), PAGE_EXECUTE_READ, &protection)) {
+            return false;
+        }
+        region->sealed = std::max(region->sealed, static_cast<size_t>(end - region->base));
+        return true;
+    }
+
+    /**
+     * @brief Encodes one instruction whose relative operands hold absolute addresses.
+     */
+    bool encode(ZydisEncoderRequest request, u64 address, std::vector<u8>& out)
+    {
+        u8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize length = sizeof(buffer);
+        if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstructionAbsolute(&request, buffer, &length, address))) {
+            return false;
+        }
+        out.insert(out.end(), buffer, buffer + length);
+        return true;
+    }
+}
+
+namespace Utils
+{
+    CaveCode& CaveCode::emit(ZydisMnemonic mnemonic, std::initializer_list<ZydisEncoderOperand> operands)
+    {
+        ZydisEncoderRequest request{};
+        request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+        request.mnemonic = mnemonic;
+        for (const auto& operand : operands) {
+            if (request.operand_count < ZYDIS_ENCODER_MAX_OPERANDS) {
+                request.operands[request.operand_count++] = operand;
+            }
+        }
+        instructions.push_back(request);
+        return *this;
+    }
+
+    ZydisEncoderOperand CaveCode::reg(ZydisRegister value)
+    {
+        ZydisEncoderOperand operand{};
+        operand.type = ZYDIS_OPERAND_TYPE_REGISTER;
+        operand.reg.value = value;
+        return operand;
+    }
+
+    ZydisEncoderOperand CaveCode::imm(i64 value)
+    {
+        ZydisEncoderOperand operand{};
+        operand.type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        operand.imm.s = value;
+        return operand;
+    }
+
+    ZydisEncoderOperand CaveCode::mem(ZydisRegister base, i64 displacement, u16 size)
+    {
+        ZydisEncoderOperand operand{};
+        operand.type = ZYDIS_OPERAND_TYPE_MEMORY;
+        operand.mem.base = base;
+        operand.mem.displacement = displacement;
+        operand.mem.size = size;
+        return operand;
+    }
+
+    std::optional<Cave> Cave::build(u64 site, const CaveCode& code)
+    {
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+        // Displace whole instructions until the jump fits, relative operands are
+        // turned into the absolute addresses they refer to.
+        std::vector<ZydisEncoderRequest> displaced;
+        std::vector<u64> boundaries;
+        std::vector<u64> targets = { site };
+        u64 length = 0;
+        while (length < JUMP_SIZE) {
+            ZydisDecodedInstruction decoded;
+            ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+            ZydisEncoderRequest request;
+            u64 address = site + length;
+            if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, reinterpret_cast<const void*>(address), ZYDIS_MAX_INSTRUCTION_LENGTH, &decoded, operands)) ||
+                !ZYAN_SUCCESS(ZydisEncoderDecodedInstructionToEncoderRequest(&decoded, operands, decoded.operand_count_visible, &request))) {
+                LOG("Failed to decode the instruction @ {:#x}", address);
+                return std::nullopt;
+            }
+            for (u8 i = 0; i < decoded.operand_count_visible; i++) {
+                const auto& operand = operands[i];
+                bool ripRelative = operand.type == ZYDIS_OPERAND_TYPE_MEMORY && operand.mem.base == ZYDIS_REGISTER_RIP;
+                bool branch = operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE && operand.imm.is_relative;
+                ZyanU64 target;
+                if ((ripRelative || branch) && !ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&decoded, &operand, address, &target))) {
+                    return std::nullopt;
+                }
+                if (ripRelative || branch) {
+                    targets.push_back(target);
+                }
+                if (ripRelative) {
+                    request.operands[i].mem.displacement = static_cast<i64>(target);
+                }
+                if (branch) {
+                    // Short branches may have to grow to reach back from the cave.
+                    request.operands[i].imm.u = target;
+                    request.branch_type = ZYDIS_BRANCH_TYPE_NONE;
+                    request.branch_width = ZYDIS_BRANCH_WIDTH_NONE;
+                }
+            }
+            displaced.push_back(request);
+            boundaries.push_back(address);
+            length += decoded.length;
+        }
+
+        // Reserve the worst case of every instruction, the constants follow the code.
+        size_t codeSize = (code.instructions.size() + displaced.size() + 1) * ZYDIS_MAX_INSTRUCTION_LENGTH;
+        size_t dataOffset = (codeSize + 15) & ~size_t(15);
+        u64 address = allocateNear(site, dataOffset + code.data.size(), targets);
+        if (address == 0) {
+            LOG("No memory for a code cave in reach of {:#x} and its relocated operands", site);
+            return std::nullopt;
+        }
+        u64 data = address + dataOffset;
+
+        Cave cave;
+        cave.address = address;
+        cave.size = dataOffset + code.data.size();
+        std::vector<u8> bytes;
+        for (auto request : code.instructions) {
+            for (u8 i = 0; i < request.operand_count; i++) {
+                auto& operand = request.operands[i];
+                if (operand.type == ZYDIS_OPERAND_TYPE_MEMORY && operand.mem.base == ZYDIS_REGISTER_RIP) {
+                    operand.mem.displacement += static_cast<i64>(data);
+                }
+            }
+            if (!encode(request, address + bytes.size(), bytes)) {
+                LOG("Failed to encode an instruction of the code cave for {:#x}", site);
+                release(cave);
+                return std::nullopt;
+            }
+        }
+        for (size_t i = 0; i < displaced.size(); i++) {
+            if (i != 0) {
+                cave.redirects.emplace_back(boundaries[i], address + bytes.size());
+            }
+            if (!encode(displaced[i], address + bytes.size(), bytes)) {
+                LOG("Failed to relocate the instruction @ {:#x}", boundaries[i]);
+                release(cave);
+                return std::nullopt;
+            }
+        }
+        ZydisEncoderRequest back{};
+        back.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+        back.mnemonic = ZYDIS_MNEMONIC_JMP;
+        back.operand_count = 1;
+        back.operands[0] = CaveCode::imm(static_cast<i64>(site + length));
+        if (!encode(back, address + bytes.size(), bytes)) {
+            release(cave);
+            return std::nullopt;
+        }
+
+        if (!store(address, bytes, dataOffset, code.data)) {
+            LOG("Failed to write the code cave for {:#x}", site);
+            release(cave);
+            return std::nullopt;
+        }
+
+        i64 rel = static_cast<i64>(address) - static_cast<i64>(site + JUMP_SIZE);
+        cave.jump.assign(static_cast<size_t>(length), 0x90);
+        cave.jump[0] = 0xE9;
+        std::memcpy(cave.jump.data() + 1, &rel, sizeof(i32));
+        return cave;
+    }
+
+    void Cave::release(const Cave& cave)
+    {
+        for (auto& region : regions) {
+            if (cave.address < region.base || cave.address >= region.base + region.size) {
+                continue;
+            }
+            if (cave.address + cave.size == region.base + region.used) {
+                region.used = static_cast<size_t>(cave.address - region.base);
+            }
+            else {
+                region.holes.emplace_back(cave.address, cave.size);
+            }
+            return;
+        }
+    }
+}
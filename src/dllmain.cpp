@@ -24,7 +24,6 @@
 
 // System includes
 #include <windows.h>
-#include <psapi.h>
 #include <shlwapi.h>
 #include <fstream>
 #include <iostream>
@@ -40,6 +39,7 @@
 
 // Local includes
 #include "utils.hpp"
+#include "signatures.hpp"
 
 // Macros
 #define VERSION "1.2.1"
@@ -66,6 +66,7 @@ typedef struct fov_t {
 
 typedef struct hud_t {
     bool enable;
+    f32 scale;
 } hud_t;
 
 typedef struct feature_t {
@@ -119,6 +120,7 @@ void logInit() {
     LOG("Module Name: {:s}", module.name);
     LOG("Module Path: {:s}", exeFilePath.string());
     LOG("Module Addr: 0x{:x}", reinterpret_cast<u64>(module.address));
+    LOG("Scan Mode: {:s}", Utils::scanModeName(Utils::detectScanMode()));
 }
 
 /**
@@ -140,6 +142,7 @@ void readYml() {
     yml.features.fov.value = config["features"]["fov"]["value"].as<f32>();
 
     yml.features.hud.enable = config["features"]["hud"]["enable"].as<bool>();
+    yml.features.hud.scale = config["features"]["hud"]["scale"].as<f32>(1.125f);
 
     if (yml.resolution.width == 0 || yml.resolution.height == 0) {
         std::pair<int, int> dimensions = Utils::getDesktopDimensions();
@@ -164,6 +167,7 @@ void readYml() {
     LOG("Features.FOV.Enable: {}", yml.features.fov.enable);
     LOG("Features.FOV.Value: {}", yml.features.fov.value);
     LOG("Features.HUD.Enable: {}", yml.features.hud.enable);
+    LOG("Features.HUD.Scale: {}", yml.features.hud.scale);
 }
 
 /**
@@ -288,9 +292,9 @@ void readYml() {
  */
 void pillarBoxFix() {
     Utils::SignaturePatch sp = {
-        .signature = "80 3D ?? ?? ?? ?? 00    74 78    F3 0F 10 44 24 60",
+        .signature = Signatures::PILLARBOX.signature,
         .patch = "01",
-        .patchOffset = 6
+        .patchOffset = Signatures::PILLARBOX.offset
     };
 
     bool enable = yml.masterEnable && yml.fixes.pillarbox.enable;
@@ -339,13 +343,14 @@ void pillarBoxFix() {
  */
 void fovFeature() {
     Utils::SignatureHook hook = {
-        .signature = "F3 0F 11 44 24 20    E8 ?? ?? ?? ??    48 8B 5C 24 50    48 83 C4 40    5F    C3    48 89 5C 24 08",
+        .signature = Signatures::FOV.signature,
+        .offset = Signatures::FOV.offset
     };
 
     bool enable = yml.masterEnable && yml.features.fov.enable;
     Utils::injectHook(enable, module, hook,
-        [](SafetyHookContext& ctx) {
-            ctx.xmm0.f32[0] = yml.features.fov.value;
+        [](Utils::Regs<Utils::Reg::xmm0>& regs) {
+            regs.get<Utils::Reg::xmm0>().f32[0] = yml.features.fov.value;
         }
     );
 }
@@ -424,26 +429,30 @@ void fovFeature() {
  * into consideration and instead multiply what is already in the xmm0 regiter by 12.5% rather than hardcode 1.125f
  * like it was done previously.
  *
+ * @note This function is called for every HUD widget, so instead of a mid-function hook that saves and restores
+ * every register on each call a code cave is injected that only runs `mulss xmm0,[scale]` before the displaced
+ * `mov rbx,[rsp+40]`. The scale is read from the yml, 1.125f by default.
+ *
  * @return void
  */
 void hudFeature() {
     Utils::SignatureHook hook = {
-        .signature = "48 8B 5C 24 40    F3 0F 5F 05 ?? ?? ?? ??",
+        .signature = Signatures::HUD.signature,
+        .offset = Signatures::HUD.offset
     };
 
     bool enable = yml.masterEnable && yml.features.hud.enable;
-    Utils::injectHook(enable, module, hook,
-        [](SafetyHookContext& ctx) {
-            ctx.xmm0.f32[0] += (ctx.xmm0.f32[0] * 0.125f);
-        }
-    );
+    Utils::CaveCode code;
+    code.emit(ZYDIS_MNEMONIC_MULSS, { Utils::CaveCode::reg(ZYDIS_REGISTER_XMM0), code.constant(yml.features.hud.scale) });
+    Utils::injectCave(enable, module, hook, code);
 }
 
 /**
  * @brief This function serves as the entry point for the DLL. It performs the following tasks:
  * 1. Initializes the logging system.
  * 2. Reads the configuration from a YAML file.
- * 3. Applies a center UI fix.
+ * 3. Queues all enabled fixes and features.
+ * 4. Resolves their signatures in a single scan and applies them.
  *
  * @param lpParameter Unused parameter.
  * @return Always returns TRUE to indicate successful execution.
@@ -454,6 +463,7 @@ DWORD WINAPI Main(void* lpParameter) {
     pillarBoxFix();
     fovFeature();
     hudFeature();
+    Utils::applyInjections("TitanQuest2Fix.cache");
     return true;
 }
 
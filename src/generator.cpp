@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <algorithm>
+
+#include "generator.hpp"
+#include "scanner.hpp"
+#include "instructions.hpp"
+
+namespace
+{
+    /**
+     * @brief Bytes following a start RVA, with the bytes that change between builds masked.
+     */
+    struct Candidate {
+        u32 rva = 0;
+        std::vector<u8> bytes;
+        std::vector<u8> mask;
+        std::vector<size_t> boundaries;     // Instruction starts, relative to `rva`
+    };
+
+    /**
+     * @brief Decodes up to `Utils::Signature::MAX_SIZE` bytes of instructions at an RVA.
+     * @details RIP-relative displacements, relative branch targets and bytes patched
+     *      by base relocations are wildcarded.
+     */
+    Candidate decodeCandidate(const Utils::ImageFile& image, const std::vector<Utils::Relocation>& relocations, u32 rva)
+    {
+        Candidate candidate;
+        candidate.rva = rva;
+        size_t limit = Utils::Signature::MAX_SIZE;
+        while (candidate.bytes.size() < limit) {
+            u32 current = rva + static_cast<u32>(candidate.bytes.size());
+            size_t available = 15;
+            while (available > 0 && image.at(current, available) == nullptr) {
+                available--;
+            }
+            if (available == 0) {
+                break;
+            }
+            u8 mask[15];
+            std::span<const u8> code(image.at(current, available), available);
+            size_t length = Utils::instructionMask(code, mask);
+            if (length == 0) {
+                break;
+            }
+            candidate.boundaries.push_back(candidate.bytes.size());
+            candidate.bytes.insert(candidate.bytes.end(), code.begin(), code.begin() + length);
+            candidate.mask.insert(candidate.mask.end(), mask, mask + length);
+        }
+        candidate.bytes.resize(std::min(candidate.bytes.size(), limit));
+        candidate.mask.resize(candidate.bytes.size());
+
+        // Relocated bytes depend on the load address.
+        auto first = std::lower_bound(relocations.begin(), relocations.end(), rva > 8 ? rva - 8 : 0,
+            [](const Utils::Relocation& relocation, u32 value) {
+                return relocation.rva < value;
+            });
+        for (auto it = first; it != relocations.end() && it->rva < rva + candidate.bytes.size(); it++) {
+            for (u32 i = 0; i < it->size; i++) {
+                u32 target = it->rva + i;
+                if (target >= rva && target < rva + candidate.bytes.size()) {
+                    candidate.mask[target - rva] = 0x00;
+                }
+            }
+        }
+        for (size_t i = 0; i < candidate.bytes.size(); i++) {
+            candidate.bytes[i] &= candidate.mask[i];
+        }
+        return candidate;
+    }
+
+    /**
+     * @brief Finds the shortest prefix of a candidate that only matches at its own RVA.
+     * @details A longer prefix can only match at a subset of the places a shorter one
+     *      matches at, so uniqueness is monotonic in the length and the shortest
+     *      length is found by binary search, each step being one index query.
+     *
+     * @return std::optional<size_t> containing the length, std::nullopt if even the
+     *      whole candidate is ambiguous.
+     */
+    std::optional<size_t> shortestUnique(const Utils::CodeIndex& index, const Candidate& candidate)
+    {
+        auto unique = [&](size_t length) {
+            Utils::PatternView view = {
+                std::span<const u8>(candidate.bytes.data(), length),
+                std::span<const u8>(candidate.mask.data(), length)
+            };
+            if (std::none_of(view.mask.begin(), view.mask.end(), [](u8 m) { return m == 0xFF; })) {
+                return false;
+            }
+            // A limited find returns an arbitrary subset, hits[0] is only meaningful
+            // because a single hit is required.
+            auto hits = index.find(view, 2);
+            return hits.size() == 1 && hits[0] == candidate.rva;
+        };
+
+        size_t low = 1;
+        size_t high = candidate.bytes.size();
+        if (high == 0 || !unique(high)) {
+            return std::nullopt;
+        }
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (unique(mid)) {
+                high = mid;
+            }
+            else {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * @brief Formats a signature the way the fixes write them, instructions separated
+     *      by four spaces.
+     */
+    std::string format(const Candidate& candidate, size_t length)
+    {
+        static const char* digits = "0123456789ABCDEF";
+        std::string text;
+        for (size_t i = 0; i < length; i++) {
+            if (i != 0) {
+                bool boundary = std::binary_search(candidate.boundaries.begin(), candidate.boundaries.end(), i);
+                text += boundary ? "    " : " ";
+            }
+            if (candidate.mask[i] == 0xFF) {
+                text += digits[candidate.bytes[i] >> 4];
+                text += digits[candidate.bytes[i] & 0xF];
+            }
+            else {
+                text += "??";
+            }
+        }
+        return text;
+    }
+
+    /**
+     * @brief Finds the instruction starts in front of an RVA using its function's range.
+     *
+     * @return std::vector<u32> containing up to `count` instruction starts before `rva`,
+     *      closest first.
+     */
+    std::vector<u32> precedingInstructions(const Utils::ImageFile& image, const Utils::FunctionIndex& functions, u32 rva, size_t count)
+    {
+        std::vector<u32> starts;
+        const Utils::Function* function = functions.find(rva);
+        if (function == nullptr || count == 0) {
+            return starts;
+        }
+        u32 current = function->begin;
+        while (current < rva) {
+            size_t available = std::min<size_t>(15, function->end - current);
+            const u8* code = image.at(current, available);
+            u8 mask[15];
+            size_t length = code ? Utils::instructionMask(std::span<const u8>(code, available), mask) : 0;
+            if (length == 0) {
+                break;
+            }
+            starts.push_back(current);
+            current += static_cast<u32>(length);
+        }
+        if (current != rva) {
+            return {};  // The RVA is not on an instruction boundary
+        }
+        std::reverse(starts.begin(), starts.end());
+        starts.resize(std::min(starts.size(), count));
+        return starts;
+    }
+}
+
+namespace Utils
+{
+    SignatureGenerator::SignatureGenerator(const ImageFile& image, const CodeIndex& index) :
+        image(image), index(index), functions(image.functions()), relocations(image.relocations())
+    {
+    }
+
+    std::optional<GeneratedSignature> SignatureGenerator::generate(u32 rva, size_t back) const
+    {
+        std::vector<u32> starts = { rva };
+        auto preceding = precedingInstructions(image, functions, rva, back);
+        starts.insert(starts.end(), preceding.begin(), preceding.end());
+
+        std::optional<GeneratedSignature> best;
+        for (u32 start : starts) {
+            Candidate candidate = decodeCandidate(image, relocations, start);
+            auto length = shortestUnique(index, candidate);
+            if (length && (!best || *length < best->length)) {
+                best = GeneratedSignature{ start, rva - start, *length, format(candidate, *length) };
+            }
+        }
+        return best;
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include "hooks.hpp"
+
+namespace
+{
+    constexpr u8 UNSAVED = 0xFF;
+
+    constexpr std::array<Utils::Reg, 31> ALL_REGISTERS = {
+        Utils::Reg::rax, Utils::Reg::rcx, Utils::Reg::rdx, Utils::Reg::rbx, Utils::Reg::rbp,
+        Utils::Reg::rsi, Utils::Reg::rdi, Utils::Reg::r8, Utils::Reg::r9, Utils::Reg::r10,
+        Utils::Reg::r11, Utils::Reg::r12, Utils::Reg::r13, Utils::Reg::r14, Utils::Reg::r15,
+        Utils::Reg::xmm0, Utils::Reg::xmm1, Utils::Reg::xmm2, Utils::Reg::xmm3,
+        Utils::Reg::xmm4, Utils::Reg::xmm5, Utils::Reg::xmm6, Utils::Reg::xmm7,
+        Utils::Reg::xmm8, Utils::Reg::xmm9, Utils::Reg::xmm10, Utils::Reg::xmm11,
+        Utils::Reg::xmm12, Utils::Reg::xmm13, Utils::Reg::xmm14, Utils::Reg::xmm15
+    };
+
+    using Gpr = decltype(SafetyHookContext::rax) SafetyHookContext::*;
+    using Vector = decltype(SafetyHookContext::xmm0) SafetyHookContext::*;
+
+    constexpr std::array<Gpr, 15> CONTEXT_GPRS = {
+        &SafetyHookContext::rax, &SafetyHookContext::rcx, &SafetyHookContext::rdx, &SafetyHookContext::rbx,
+        &SafetyHookContext::rbp, &SafetyHookContext::rsi, &SafetyHookContext::rdi, &SafetyHookContext::r8,
+        &SafetyHookContext::r9, &SafetyHookContext::r10, &SafetyHookContext::r11, &SafetyHookContext::r12,
+        &SafetyHookContext::r13, &SafetyHookContext::r14, &SafetyHookContext::r15
+    };
+
+    constexpr std::array<Vector, 16> CONTEXT_XMMS = {
+        &SafetyHookContext::xmm0, &SafetyHookContext::xmm1, &SafetyHookContext::xmm2, &SafetyHookContext::xmm3,
+        &SafetyHookContext::xmm4, &SafetyHookContext::xmm5, &SafetyHookContext::xmm6, &SafetyHookContext::xmm7,
+        &SafetyHookContext::xmm8, &SafetyHookContext::xmm9, &SafetyHookContext::xmm10, &SafetyHookContext::xmm11,
+        &SafetyHookContext::xmm12, &SafetyHookContext::xmm13, &SafetyHookContext::xmm14, &SafetyHookContext::xmm15
+    };
+
+    constexpr size_t PUSHED_FLAGS = 8;      // rbx, r11 down to rax, then the flags
+
+    void adaptContext(Utils::Xmm* slots, const u8* index, u64* pushed, void* callback)
+    {
+        SafetyHookContext ctx{};
+        for (size_t i = 0; i < CONTEXT_GPRS.size(); i++) {
+            std::memcpy(&(ctx.*CONTEXT_GPRS[i]), &slots[index[i]], sizeof(u64));
+        }
+        for (size_t i = 0; i < CONTEXT_XMMS.size(); i++) {
+            std::memcpy(&(ctx.*CONTEXT_XMMS[i]), &slots[index[CONTEXT_GPRS.size() + i]], sizeof(Utils::Xmm));
+        }
+        ctx.rflags = pushed[PUSHED_FLAGS];
+        ctx.rsp = reinterpret_cast<u64>(pushed + PUSHED_FLAGS + 1);
+
+        reinterpret_cast<safetyhook::MidHookFn>(callback)(ctx);
+
+        for (size_t i = 0; i < CONTEXT_GPRS.size(); i++) {
+            std::memcpy(&slots[index[i]], &(ctx.*CONTEXT_GPRS[i]), sizeof(u64));
+        }
+        for (size_t i = 0; i < CONTEXT_XMMS.size(); i++) {
+            std::memcpy(&slots[index[CONTEXT_GPRS.size() + i]], &(ctx.*CONTEXT_XMMS[i]), sizeof(Utils::Xmm));
+        }
+        pushed[PUSHED_FLAGS] = ctx.rflags;
+    }
+}
+
+namespace Utils
+{
+    HookSite::HookSite(u64 address, std::vector<Utils::HookCallback> callbacks) : site(address)
+    {
+        for (const auto& callback : callbacks) {
+            registers.insert(registers.end(), callback.registers.begin(), callback.registers.end());
+        }
+        std::sort(registers.begin(), registers.end());
+        registers.erase(std::unique(registers.begin(), registers.end()), registers.end());
+
+        index.fill(UNSAVED);
+        for (size_t i = 0; i < registers.size(); i++) {
+            index[static_cast<size_t>(registers[i])] = static_cast<u8>(i);
+        }
+
+        generations.push_back(std::make_unique<const Callbacks>(std::move(callbacks)));
+        current.store(generations.back().get(), std::memory_order_release);
+    }
+
+    Utils::CaveCode HookSite::code() const
+    {
+        return Utils::midHookCode(registers, reinterpret_cast<u64>(&HookSite::dispatch), reinterpret_cast<u64>(this));
+    }
+
+    std::vector<Utils::HookCallback> HookSite::callbacks() const
+    {
+        return *current.load(std::memory_order_acquire);
+    }
+
+    bool HookSite::swap(std::vector<Utils::HookCallback> callbacks)
+    {
+        std::lock_guard lock(mutex);
+        return replace(std::move(callbacks));
+    }
+
+    bool HookSite::replace(Callbacks callbacks)
+    {
+        for (const auto& callback : callbacks) {
+            for (auto reg : callback.registers) {
+                if (index[static_cast<size_t>(reg)] == UNSAVED) {
+                    return false;
+                }
+            }
+        }
+        generations.push_back(std::make_unique<const Callbacks>(std::move(callbacks)));
+        current.store(generations.back().get(), std::memory_order_release);
+        return true;
+    }
+
+    void HookSite::dispatch(Utils::Xmm* slots, const HookSite* site, u64* pushed)
+    {
+        const Callbacks* callbacks = site->current.load(std::memory_order_acquire);
+        for (const auto& entry : *callbacks) {
+            entry.adapter(slots, site->index.data(), pushed, entry.callback);
+        }
+    }
+
+    Utils::HookCallback wrapContext(safetyhook::MidHookFn callback)
+    {
+        return { &adaptContext, reinterpret_cast<void*>(callback), ALL_REGISTERS };
+    }
+}
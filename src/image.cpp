@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "image.hpp"
+
+namespace
+{
+    /**
+     * @brief Maps a whole file into memory read-only.
+     *
+     * @param path Path of the file.
+     * @param size Receives the size of the file.
+     * @return std::shared_ptr<const u8> owning the mapping, nullptr if the file could
+     *      not be mapped or is empty.
+     */
+    std::shared_ptr<const u8> mapFile(const std::string& path, size_t& size)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER fileSize{};
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart != 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return nullptr;
+        }
+        // The view keeps the mapping object alive on its own.
+        auto view = static_cast<const u8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (view == nullptr) {
+            return nullptr;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        return std::shared_ptr<const u8>(view, [](const u8* address) {
+            UnmapViewOfFile(address);
+        });
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return nullptr;
+        }
+        struct stat status{};
+        void* view = MAP_FAILED;
+        if (fstat(file, &status) == 0 && status.st_size != 0) {
+            view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        }
+        close(file);
+        if (view == MAP_FAILED) {
+            return nullptr;
+        }
+        size = static_cast<size_t>(status.st_size);
+        return std::shared_ptr<const u8>(static_cast<const u8*>(view), [size](const u8* address) {
+            munmap(const_cast<u8*>(address), size);
+        });
+#endif
+    }
+}
+
+namespace Utils
+{
+    bool ImageFile::load(const std::string& path)
+    {
+        size_t size = 0;
+        mapping = mapFile(path, size);
+        if (!mapping) {
+            bytes = {};
+            return false;
+        }
+        bytes = std::span<const u8>(mapping.get(), size);
+
+        auto parsed = Utils::parsePe(bytes);
+        if (!parsed) {
+            return false;
+        }
+        pe = std::move(*parsed);
+        return true;
+    }
+
+    std::vector<MappedSection> ImageFile::sections(const std::string& section) const
+    {
+        std::vector<MappedSection> mapped;
+        for (const auto& sec : pe.sections) {
+            bool selected = section.empty() ? sec.executable() : (sec.name == section);
+            if (!selected || sec.rawOffset >= bytes.size()) {
+                continue;
+            }
+            size_t size = std::min<size_t>({ sec.size, sec.rawSize, bytes.size() - sec.rawOffset });
+            if (size != 0) {
+                mapped.push_back({ sec.rva, std::span<const u8>(bytes).subspan(sec.rawOffset, size) });
+            }
+        }
+        std::sort(mapped.begin(), mapped.end(), [](const MappedSection& a, const MappedSection& b) {
+            return a.rva < b.rva;
+        });
+        return mapped;
+    }
+
+    const u8* ImageFile::at(u32 rva, size_t size) const
+    {
+        for (const auto& sec : pe.sections) {
+            u32 backed = std::min(sec.size, sec.rawSize);
+            if (rva < sec.rva || rva - sec.rva >= backed) {
+                continue;
+            }
+            size_t offset = static_cast<size_t>(sec.rawOffset) + (rva - sec.rva);
+            if (offset >= bytes.size()) {
+                return nullptr;
+            }
+            size_t available = std::min<size_t>(backed - (rva - sec.rva), bytes.size() - offset);
+            return size <= available ? bytes.data() + offset : nullptr;
+        }
+        if (rva < pe.sizeOfHeaders && static_cast<size_t>(rva) + size <= std::min<size_t>(pe.sizeOfHeaders, bytes.size())) {
+            return bytes.data() + rva;
+        }
+        return nullptr;
+    }
+
+    FunctionIndex ImageFile::functions() const
+    {
+        const auto& directory = pe.directories[DIRECTORY_EXCEPTION];
+        const u8* table = at(directory.rva, directory.size);
+        return table ? FunctionIndex({ table, directory.size }) : FunctionIndex();
+    }
+
+    std::vector<Relocation> ImageFile::relocations() const
+    {
+        const auto& directory = pe.directories[DIRECTORY_BASERELOC];
+        const u8* table = at(directory.rva, directory.size);
+        return table ? parseRelocations({ table, directory.size }) : std::vector<Relocation>();
+    }
+}
@@ -0,0 +1,481 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+
+// 3rd party includes
+#include <Zydis/Zydis.h>
+
+#include "instructions.hpp"
+
+namespace
+{
+    constexpr size_t FUNCTIONS_PER_BATCH = 256;
+
+    /**
+     * @brief Output of decoding a piece of code.
+     */
+    struct Decoded {
+        std::vector<Utils::Instruction> instructions;
+        std::vector<Utils::Reference> immediates;
+        std::vector<Utils::Reference> targets;
+    };
+
+    /**
+     * @brief Decodes one instruction into its compact form.
+     *
+     * @param decoder Initialized 64-bit decoder.
+     * @param data Bytes to decode.
+     * @param size Number of readable bytes at `data`.
+     * @param rva RVA of `data`.
+     * @param out Receives the instruction and the values it refers to.
+     * @return true if the bytes form a valid instruction.
+     */
+    bool decode(const ZydisDecoder& decoder, const u8* data, size_t size, u32 rva, Decoded& out)
+    {
+        ZydisDecodedInstruction decoded;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, data, size, &decoded, operands))) {
+            return false;
+        }
+
+        Utils::Instruction instruction;
+        instruction.rva = rva;
+        instruction.mnemonic = static_cast<u16>(decoded.mnemonic);
+        instruction.length = decoded.length;
+        instruction.operandCount = static_cast<u8>(std::min<size_t>(decoded.operand_count_visible, instruction.kinds.size()));
+        for (size_t i = 0; i < instruction.operandCount; i++) {
+            switch (operands[i].type) {
+            case ZYDIS_OPERAND_TYPE_REGISTER:
+                instruction.kinds[i] = Utils::OperandKind::Register;
+                instruction.registers[i] = static_cast<u16>(operands[i].reg.value);
+                break;
+            case ZYDIS_OPERAND_TYPE_MEMORY:
+                instruction.kinds[i] = Utils::OperandKind::Memory;
+                break;
+            case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                instruction.kinds[i] = Utils::OperandKind::Immediate;
+                break;
+            case ZYDIS_OPERAND_TYPE_POINTER:
+                instruction.kinds[i] = Utils::OperandKind::Pointer;
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Hidden operands never carry immediates or RIP-relative addresses, so
+        // the visible ones are enough.
+        for (size_t i = 0; i < decoded.operand_count_visible; i++) {
+            const auto& operand = operands[i];
+            bool relative = (operand.type == ZYDIS_OPERAND_TYPE_MEMORY && operand.mem.base == ZYDIS_REGISTER_RIP) ||
+                (operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE && operand.imm.is_relative);
+            if (relative) {
+                // Using the RVA as runtime address yields the target as an RVA.
+                ZyanU64 target;
+                if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&decoded, &operand, rva, &target)) && target <= UINT32_MAX) {
+                    out.targets.push_back({ static_cast<u32>(target), rva });
+                }
+            }
+            else if (operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE) {
+                u64 value = operand.imm.value.u;
+                if ((value >> 32) == 0 || (static_cast<i64>(value) >> 31) == -1) {
+                    out.immediates.push_back({ static_cast<u32>(value), rva });
+                }
+            }
+        }
+
+        out.instructions.push_back(instruction);
+        return true;
+    }
+
+    /**
+     * @brief Decodes a range of code until the end or the first invalid instruction.
+     */
+    void decodeRange(const ZydisDecoder& decoder, const u8* base, u32 begin, u32 end, Decoded& out)
+    {
+        u32 rva = begin;
+        while (rva < end && decode(decoder, base + rva, end - rva, rva, out)) {
+            rva += out.instructions.back().length;
+        }
+    }
+
+    /**
+     * @brief Finds the references to a value in a table sorted by value.
+     */
+    std::span<const Utils::Reference> lookup(const std::vector<Utils::Reference>& table, u32 value)
+    {
+        auto [first, last] = std::equal_range(table.begin(), table.end(), Utils::Reference{ value, 0 },
+            [](const Utils::Reference& a, const Utils::Reference& b) {
+                return a.value < b.value;
+            });
+        return { first, last };
+    }
+
+    /**
+     * @brief Looks up Zydis enum values by their lower case names.
+     */
+    struct Names {
+        std::unordered_map<std::string, u16> mnemonics;
+        std::unordered_map<std::string, u16> registers;
+
+        Names()
+        {
+            for (u32 i = 1; i <= ZYDIS_MNEMONIC_MAX_VALUE; i++) {
+                if (const char* name = ZydisMnemonicGetString(static_cast<ZydisMnemonic>(i))) {
+                    mnemonics.emplace(name, static_cast<u16>(i));
+                }
+            }
+            for (u32 i = 1; i <= ZYDIS_REGISTER_MAX_VALUE; i++) {
+                if (const char* name = ZydisRegisterGetString(static_cast<ZydisRegister>(i))) {
+                    registers.emplace(name, static_cast<u16>(i));
+                }
+            }
+        }
+    };
+
+    const Names& names()
+    {
+        static const Names table;
+        return table;
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+        size_t begin = text.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        size_t end = text.find_last_not_of(" \t");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    std::string lower(std::string_view text)
+    {
+        std::string result(text);
+        for (char& c : result) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return result;
+    }
+
+    Utils::InstructionPattern::Operand parseOperand(std::string_view text)
+    {
+        using Operand = Utils::InstructionPattern::Operand;
+        static const std::unordered_map<std::string, Utils::OperandKind> kinds = {
+            { "reg", Utils::OperandKind::Register },
+            { "mem", Utils::OperandKind::Memory },
+            { "imm", Utils::OperandKind::Immediate },
+            { "ptr", Utils::OperandKind::Pointer }
+        };
+        static const std::unordered_map<std::string, ZydisRegisterClass> classes = {
+            { "gpr8?", ZYDIS_REGCLASS_GPR8 },
+            { "gpr16?", ZYDIS_REGCLASS_GPR16 },
+            { "gpr32?", ZYDIS_REGCLASS_GPR32 },
+            { "gpr64?", ZYDIS_REGCLASS_GPR64 },
+            { "xmm?", ZYDIS_REGCLASS_XMM },
+            { "ymm?", ZYDIS_REGCLASS_YMM },
+            { "zmm?", ZYDIS_REGCLASS_ZMM }
+        };
+
+        std::string token = lower(trim(text));
+        Operand operand;
+        if (token == "?") {
+            return operand;
+        }
+        if (auto it = kinds.find(token); it != kinds.end()) {
+            operand.type = Operand::Type::Kind;
+            operand.kind = it->second;
+            return operand;
+        }
+        if (auto it = classes.find(token); it != classes.end()) {
+            operand.type = Operand::Type::RegisterClass;
+            operand.value = static_cast<u16>(it->second);
+            return operand;
+        }
+        if (auto it = names().registers.find(token); it != names().registers.end()) {
+            operand.type = Operand::Type::Register;
+            operand.value = it->second;
+            return operand;
+        }
+        throw std::invalid_argument("unknown operand '" + token + "'");
+    }
+
+    bool matchOperand(const Utils::InstructionPattern::Operand& operand, const Utils::Instruction& instruction, size_t i)
+    {
+        using Type = Utils::InstructionPattern::Operand::Type;
+        switch (operand.type) {
+        case Type::Kind:
+            return instruction.kinds[i] == operand.kind;
+        case Type::Register:
+            return instruction.kinds[i] == Utils::OperandKind::Register && instruction.registers[i] == operand.value;
+        case Type::RegisterClass:
+            return instruction.kinds[i] == Utils::OperandKind::Register &&
+                ZydisRegisterGetClass(static_cast<ZydisRegister>(instruction.registers[i])) == operand.value;
+        default:
+            return true;
+        }
+    }
+
+    bool matchElement(const Utils::InstructionPattern::Element& element, const Utils::Instruction& instruction)
+    {
+        if (element.anyInstruction) {
+            return true;
+        }
+        if (instruction.mnemonic != element.mnemonic) {
+            return false;
+        }
+        if (!element.checkOperands) {
+            return true;
+        }
+        if (instruction.operandCount != element.operandCount) {
+            return false;
+        }
+        for (size_t i = 0; i < element.operandCount; i++) {
+            if (!matchOperand(element.operands[i], instruction, i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+namespace Utils
+{
+    InstructionPattern compileInstructionPattern(std::string_view text)
+    {
+        InstructionPattern pattern;
+        while (!text.empty()) {
+            size_t separator = text.find(';');
+            std::string_view statement = trim(text.substr(0, separator));
+            text = (separator == std::string_view::npos) ? std::string_view{} : text.substr(separator + 1);
+            if (statement.empty()) {
+                continue;
+            }
+
+            InstructionPattern::Element element;
+            size_t space = statement.find_first_of(" \t");
+            std::string mnemonic = lower(statement.substr(0, space));
+            std::string_view operands = (space == std::string_view::npos) ? std::string_view{} : trim(statement.substr(space));
+            if (mnemonic == "?") {
+                element.anyInstruction = true;
+                pattern.elements.push_back(element);
+                continue;
+            }
+            auto it = names().mnemonics.find(mnemonic);
+            if (it == names().mnemonics.end()) {
+                throw std::invalid_argument("unknown mnemonic '" + mnemonic + "'");
+            }
+            element.mnemonic = it->second;
+
+            while (!operands.empty()) {
+                if (element.operandCount == element.operands.size()) {
+                    throw std::invalid_argument("too many operands for '" + mnemonic + "'");
+                }
+                size_t comma = operands.find(',');
+                element.operands[element.operandCount++] = parseOperand(operands.substr(0, comma));
+                element.checkOperands = true;
+                operands = (comma == std::string_view::npos) ? std::string_view{} : operands.substr(comma + 1);
+            }
+            pattern.elements.push_back(element);
+        }
+        if (pattern.elements.empty()) {
+            throw std::invalid_argument("instruction signature is empty");
+        }
+        return pattern;
+    }
+
+    size_t instructionMask(std::span<const u8> code, std::span<u8> mask)
+    {
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+        ZydisDecodedInstruction decoded;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, code.data(), code.size(), &decoded, operands)) ||
+            mask.size() < decoded.length) {
+            return 0;
+        }
+
+        std::fill(mask.begin(), mask.begin() + decoded.length, 0xFF);
+        auto clear = [&](u8 offset, u8 bits) {
+            std::fill(mask.begin() + offset, mask.begin() + std::min<size_t>(offset + bits / 8, decoded.length), 0x00);
+        };
+        for (size_t i = 0; i < decoded.operand_count_visible; i++) {
+            if (operands[i].type == ZYDIS_OPERAND_TYPE_MEMORY && operands[i].mem.base == ZYDIS_REGISTER_RIP) {
+                clear(decoded.raw.disp.offset, decoded.raw.disp.size);
+            }
+        }
+        for (const auto& imm : decoded.raw.imm) {
+            if (imm.is_relative) {
+                clear(imm.offset, imm.size);
+            }
+        }
+        return decoded.length;
+    }
+
+    FunctionShape functionShape(std::span<const u8> code)
+    {
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+        FunctionShape shape;
+        shape.hash = 0xCBF29CE484222325;
+        auto mix = [&shape](u64 value) {
+            shape.hash ^= value;
+            shape.hash *= 0x100000001B3;
+        };
+
+        Decoded decoded;
+        size_t offset = 0;
+        while (offset < code.size() &&
+               decode(decoder, code.data() + offset, code.size() - offset, static_cast<u32>(offset), decoded)) {
+            const auto& instruction = decoded.instructions.back();
+            mix(instruction.mnemonic);
+            mix(instruction.operandCount);
+            for (size_t i = 0; i < instruction.operandCount; i++) {
+                mix(static_cast<u64>(instruction.kinds[i]));
+            }
+            shape.offsets.push_back(static_cast<u32>(offset));
+            offset += instruction.length;
+        }
+        return shape;
+    }
+
+    InstructionIndex::InstructionIndex(const u8* base, std::span<const Function> functions, u32 threads)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t batches = (functions.size() + FUNCTIONS_PER_BATCH - 1) / FUNCTIONS_PER_BATCH;
+        threads = static_cast<u32>(std::min<size_t>(threads, batches));
+
+        // Batches are decoded into their own vectors and joined in order afterwards,
+        // so the index stays sorted by address.
+        std::vector<Decoded> results(batches);
+        std::atomic<size_t> next = 0;
+        auto worker = [&]() {
+            ZydisDecoder decoder;
+            ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+            size_t batch;
+            while ((batch = next.fetch_add(1, std::memory_order_relaxed)) < batches) {
+                size_t first = batch * FUNCTIONS_PER_BATCH;
+                size_t last = std::min(functions.size(), first + FUNCTIONS_PER_BATCH);
+                for (size_t i = first; i < last; i++) {
+                    decodeRange(decoder, base, functions[i].begin, functions[i].end, results[batch]);
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (u32 i = 1; i < threads; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+
+        size_t total = 0;
+        for (const auto& result : results) {
+            total += result.instructions.size();
+        }
+        decoded.reserve(total);
+        for (const auto& result : results) {
+            decoded.insert(decoded.end(), result.instructions.begin(), result.instructions.end());
+            immediates.insert(immediates.end(), result.immediates.begin(), result.immediates.end());
+            targets.insert(targets.end(), result.targets.begin(), result.targets.end());
+        }
+        sortReferences();
+    }
+
+    InstructionIndex::InstructionIndex(const u8* base, std::span<const std::span<const u8>> regions)
+    {
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+        Decoded result;
+        for (const auto& region : regions) {
+            size_t offset = 0;
+            while (offset < region.size()) {
+                u32 rva = static_cast<u32>(region.data() + offset - base);
+                if (decode(decoder, region.data() + offset, region.size() - offset, rva, result)) {
+                    offset += result.instructions.back().length;
+                }
+                else {
+                    offset++;
+                }
+            }
+        }
+        decoded = std::move(result.instructions);
+        immediates = std::move(result.immediates);
+        targets = std::move(result.targets);
+        sortReferences();
+    }
+
+    void InstructionIndex::sortReferences()
+    {
+        auto order = [](const Reference& a, const Reference& b) {
+            return a.value != b.value ? a.value < b.value : a.rva < b.rva;
+        };
+        std::sort(immediates.begin(), immediates.end(), order);
+        std::sort(targets.begin(), targets.end(), order);
+    }
+
+    std::span<const Reference> InstructionIndex::constantUses(u32 value) const
+    {
+        return lookup(immediates, value);
+    }
+
+    std::span<const Reference> InstructionIndex::referencesTo(u32 rva) const
+    {
+        return lookup(targets, rva);
+    }
+
+    std::vector<u32> InstructionIndex::find(const InstructionPattern& pattern) const
+    {
+        std::vector<u32> hits;
+        size_t count = pattern.elements.size();
+        for (size_t i = 0; i + count <= decoded.size(); i++) {
+            size_t j = 0;
+            while (j < count && matchElement(pattern.elements[j], decoded[i + j]) &&
+                   (j == 0 || decoded[i + j].rva == decoded[i + j - 1].rva + decoded[i + j - 1].length)) {
+                j++;
+            }
+            if (j == count) {
+                hits.push_back(decoded[i].rva);
+            }
+        }
+        return hits;
+    }
+}
@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string>
+#include <span>
+#include <optional>
+#include <cstring>
+#include <algorithm>
+
+#include "pe.hpp"
+
+namespace
+{
+    // Offsets into the PE headers, see IMAGE_DOS_HEADER, IMAGE_NT_HEADERS64 and
+    // IMAGE_SECTION_HEADER in winnt.h. The structures are read field by field so the
+    // parser does not depend on windows.h and works on unaligned file buffers.
+    constexpr size_t DOS_E_LFANEW = 0x3C;
+    constexpr size_t NT_FILE_HEADER = 0x04;
+    constexpr size_t NT_OPTIONAL_HEADER = 0x18;
+    constexpr size_t FILE_NUMBER_OF_SECTIONS = 0x02;
+    constexpr size_t FILE_TIME_DATE_STAMP = 0x04;
+    constexpr size_t FILE_SIZE_OF_OPTIONAL_HEADER = 0x10;
+    constexpr size_t OPT_MAGIC = 0x00;
+    constexpr size_t OPT_SIZE_OF_IMAGE = 0x38;
+    constexpr size_t OPT_SIZE_OF_HEADERS = 0x3C;
+    constexpr size_t OPT_CHECK_SUM = 0x40;
+    constexpr size_t OPT_NUMBER_OF_RVA_AND_SIZES = 0x6C;
+    constexpr size_t OPT_DATA_DIRECTORY = 0x70;
+    constexpr size_t DATA_DIRECTORY_SIZE = 0x08;
+    constexpr size_t RUNTIME_FUNCTION_SIZE = 0x0C;
+    constexpr size_t BASE_RELOCATION_HEADER_SIZE = 0x08;
+    constexpr size_t SECTION_HEADER_SIZE = 0x28;
+    constexpr size_t SECTION_VIRTUAL_SIZE = 0x08;
+    constexpr size_t SECTION_VIRTUAL_ADDRESS = 0x0C;
+    constexpr size_t SECTION_SIZE_OF_RAW_DATA = 0x10;
+    constexpr size_t SECTION_POINTER_TO_RAW_DATA = 0x14;
+    constexpr size_t SECTION_CHARACTERISTICS = 0x24;
+
+    constexpr u16 DOS_MAGIC = 0x5A4D;      // "MZ"
+    constexpr u32 NT_SIGNATURE = 0x4550;   // "PE\0\0"
+    constexpr u16 PE32_PLUS_MAGIC = 0x20B;
+
+    template <typename T>
+    std::optional<T> read(std::span<const u8> data, size_t offset)
+    {
+        if (offset > data.size() || data.size() - offset < sizeof(T)) {
+            return std::nullopt;
+        }
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+}
+
+namespace Utils
+{
+    std::optional<PeInfo> parsePe(std::span<const u8> data)
+    {
+        auto dosMagic = read<u16>(data, 0);
+        auto lfanew = read<u32>(data, DOS_E_LFANEW);
+        if (!dosMagic || *dosMagic != DOS_MAGIC || !lfanew) {
+            return std::nullopt;
+        }
+
+        size_t nt = *lfanew;
+        auto signature = read<u32>(data, nt);
+        auto sectionCount = read<u16>(data, nt + NT_FILE_HEADER + FILE_NUMBER_OF_SECTIONS);
+        auto timeDateStamp = read<u32>(data, nt + NT_FILE_HEADER + FILE_TIME_DATE_STAMP);
+        auto optionalSize = read<u16>(data, nt + NT_FILE_HEADER + FILE_SIZE_OF_OPTIONAL_HEADER);
+        auto magic = read<u16>(data, nt + NT_OPTIONAL_HEADER + OPT_MAGIC);
+        auto sizeOfImage = read<u32>(data, nt + NT_OPTIONAL_HEADER + OPT_SIZE_OF_IMAGE);
+        auto sizeOfHeaders = read<u32>(data, nt + NT_OPTIONAL_HEADER + OPT_SIZE_OF_HEADERS);
+        auto checkSum = read<u32>(data, nt + NT_OPTIONAL_HEADER + OPT_CHECK_SUM);
+        if (!signature || *signature != NT_SIGNATURE || !magic || *magic != PE32_PLUS_MAGIC ||
+            !sectionCount || !timeDateStamp || !optionalSize || !sizeOfImage || !sizeOfHeaders || !checkSum) {
+            return std::nullopt;
+        }
+
+        PeInfo info;
+        info.timeDateStamp = *timeDateStamp;
+        info.checkSum = *checkSum;
+        info.sizeOfImage = *sizeOfImage;
+        info.sizeOfHeaders = *sizeOfHeaders;
+
+        auto directoryCount = read<u32>(data, nt + NT_OPTIONAL_HEADER + OPT_NUMBER_OF_RVA_AND_SIZES);
+        for (size_t i = 0; directoryCount && i < std::min<size_t>(*directoryCount, DIRECTORY_COUNT); i++) {
+            size_t offset = OPT_DATA_DIRECTORY + i * DATA_DIRECTORY_SIZE;
+            if (offset + DATA_DIRECTORY_SIZE > *optionalSize) {
+                break;
+            }
+            auto rva = read<u32>(data, nt + NT_OPTIONAL_HEADER + offset);
+            auto size = read<u32>(data, nt + NT_OPTIONAL_HEADER + offset + 4);
+            if (!rva || !size) {
+                return std::nullopt;
+            }
+            info.directories[i] = { *rva, *size };
+        }
+
+        size_t table = nt + NT_OPTIONAL_HEADER + *optionalSize;
+        for (size_t i = 0; i < *sectionCount; i++) {
+            size_t header = table + i * SECTION_HEADER_SIZE;
+            if (header > data.size() || data.size() - header < SECTION_HEADER_SIZE) {
+                return std::nullopt;
+            }
+            const char* name = reinterpret_cast<const char*>(data.data() + header);
+            Section section;
+            section.name = std::string(name, strnlen(name, 8));
+            section.size = *read<u32>(data, header + SECTION_VIRTUAL_SIZE);
+            section.rva = *read<u32>(data, header + SECTION_VIRTUAL_ADDRESS);
+            section.rawSize = *read<u32>(data, header + SECTION_SIZE_OF_RAW_DATA);
+            section.rawOffset = *read<u32>(data, header + SECTION_POINTER_TO_RAW_DATA);
+            section.characteristics = *read<u32>(data, header + SECTION_CHARACTERISTICS);
+            info.sections.push_back(section);
+        }
+        return info;
+    }
+
+    std::vector<Relocation> parseRelocations(std::span<const u8> table)
+    {
+        constexpr u8 REL_BASED_HIGHLOW = 3;
+        constexpr u8 REL_BASED_DIR64 = 10;
+
+        // The table is a list of blocks, each one covering a 4 KiB page with a
+        // header followed by 16-bit entries: 4 bits of type and 12 bits of offset.
+        std::vector<Relocation> relocations;
+        size_t block = 0;
+        while (block + BASE_RELOCATION_HEADER_SIZE <= table.size()) {
+            u32 page = *read<u32>(table, block);
+            u32 blockSize = *read<u32>(table, block + 4);
+            if (blockSize < BASE_RELOCATION_HEADER_SIZE || blockSize > table.size() - block) {
+                break;
+            }
+            for (size_t entry = block + BASE_RELOCATION_HEADER_SIZE; entry + 2 <= block + blockSize; entry += 2) {
+                u16 value = *read<u16>(table, entry);
+                u8 type = static_cast<u8>(value >> 12);
+                if (type == REL_BASED_DIR64 || type == REL_BASED_HIGHLOW) {
+                    relocations.push_back({ page + (value & 0xFFF), static_cast<u8>(type == REL_BASED_DIR64 ? 8 : 4) });
+                }
+            }
+            block += blockSize;
+        }
+        std::sort(relocations.begin(), relocations.end(), [](const Relocation& a, const Relocation& b) {
+            return a.rva < b.rva;
+        });
+        return relocations;
+    }
+
+    FunctionIndex::FunctionIndex(std::span<const u8> table)
+    {
+        for (size_t offset = 0; offset + RUNTIME_FUNCTION_SIZE <= table.size(); offset += RUNTIME_FUNCTION_SIZE) {
+            u32 begin = *read<u32>(table, offset);
+            u32 end = *read<u32>(table, offset + 4);
+            if (begin < end) {
+                ranges.push_back({ begin, end });
+            }
+        }
+        // The table is sorted by the linker, but do not rely on it.
+        std::sort(ranges.begin(), ranges.end(), [](const Function& a, const Function& b) {
+            return a.begin < b.begin;
+        });
+    }
+
+    const Function* FunctionIndex::find(u32 rva) const
+    {
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), rva, [](u32 value, const Function& function) {
+            return value < function.begin;
+        });
+        if (it == ranges.begin() || rva >= std::prev(it)->end) {
+            return nullptr;
+        }
+        return &*std::prev(it);
+    }
+
+    bool FunctionIndex::contains(u32 rva, u32 size) const
+    {
+        const Function* function = find(rva);
+        return function != nullptr && static_cast<u64>(rva) + size <= function->end;
+    }
+}
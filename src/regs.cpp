@@ -0,0 +1,157 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <optional>
+
+#include "regs.hpp"
+
+namespace
+{
+    // Pushed in this order, rbx last as it holds the frame.
+    constexpr std::array<ZydisRegister, 7> VOLATILE = {
+        ZYDIS_REGISTER_RAX, ZYDIS_REGISTER_RCX, ZYDIS_REGISTER_RDX,
+        ZYDIS_REGISTER_R8, ZYDIS_REGISTER_R9, ZYDIS_REGISTER_R10, ZYDIS_REGISTER_R11
+    };
+
+    constexpr std::array<ZydisRegister, 15> GPRS = {
+        ZYDIS_REGISTER_RAX, ZYDIS_REGISTER_RCX, ZYDIS_REGISTER_RDX, ZYDIS_REGISTER_RBX,
+        ZYDIS_REGISTER_RBP, ZYDIS_REGISTER_RSI, ZYDIS_REGISTER_RDI, ZYDIS_REGISTER_R8,
+        ZYDIS_REGISTER_R9, ZYDIS_REGISTER_R10, ZYDIS_REGISTER_R11, ZYDIS_REGISTER_R12,
+        ZYDIS_REGISTER_R13, ZYDIS_REGISTER_R14, ZYDIS_REGISTER_R15
+    };
+
+    constexpr size_t VOLATILE_XMM = 6;          // xmm0-xmm5
+    constexpr size_t SHADOW_SPACE = 32;
+
+    ZydisRegister zydisRegister(Utils::Reg reg)
+    {
+        auto index = static_cast<size_t>(reg);
+        if (reg >= Utils::Reg::xmm0) {
+            return static_cast<ZydisRegister>(ZYDIS_REGISTER_XMM0 + (index - static_cast<size_t>(Utils::Reg::xmm0)));
+        }
+        return GPRS[index];
+    }
+
+    /**
+     * @brief Offset from the frame of the stack slot a register was pushed to, if any.
+     */
+    std::optional<i64> pushedAt(ZydisRegister reg)
+    {
+        if (reg == ZYDIS_REGISTER_RBX) {
+            return 0;
+        }
+        for (size_t i = 0; i < VOLATILE.size(); i++) {
+            if (VOLATILE[i] == reg) {
+                return static_cast<i64>((VOLATILE.size() - i) * 8);
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+namespace Utils
+{
+    Utils::CaveCode midHookCode(std::span<const Utils::Reg> registers, u64 callback, u64 argument)
+    {
+        using C = Utils::CaveCode;
+        const auto rsp = C::reg(ZYDIS_REGISTER_RSP);
+        const auto rbx = C::reg(ZYDIS_REGISTER_RBX);
+        const auto rax = C::reg(ZYDIS_REGISTER_RAX);
+        const auto rcx = C::reg(ZYDIS_REGISTER_RCX);
+        const auto rdx = C::reg(ZYDIS_REGISTER_RDX);
+        const auto r8 = C::reg(ZYDIS_REGISTER_R8);
+        const size_t slots = SHADOW_SPACE;
+        const size_t saved = slots + registers.size() * 16;
+        const size_t frame = saved + VOLATILE_XMM * 16;
+
+        Utils::CaveCode code;
+        auto target = code.constant(callback);
+        auto second = code.constant(argument);
+
+        // Save what the call may clobber and align the stack, rbx keeps the frame.
+        code.emit(ZYDIS_MNEMONIC_PUSHFQ, {});
+        for (auto reg : VOLATILE) {
+            code.emit(ZYDIS_MNEMONIC_PUSH, { C::reg(reg) });
+        }
+        code.emit(ZYDIS_MNEMONIC_PUSH, { rbx });
+        code.emit(ZYDIS_MNEMONIC_MOV, { rbx, rsp });
+        code.emit(ZYDIS_MNEMONIC_AND, { rsp, C::imm(-16) });
+        code.emit(ZYDIS_MNEMONIC_SUB, { rsp, C::imm(static_cast<i64>(frame)) });
+        for (size_t i = 0; i < VOLATILE_XMM; i++) {
+            auto xmm = static_cast<ZydisRegister>(ZYDIS_REGISTER_XMM0 + i);
+            code.emit(ZYDIS_MNEMONIC_MOVAPS, { C::mem(ZYDIS_REGISTER_RSP, static_cast<i64>(saved + i * 16), 16), C::reg(xmm) });
+        }
+
+        // Copy the requested registers into their slots, pushed registers are taken from the stack.
+        for (size_t i = 0; i < registers.size(); i++) {
+            auto reg = zydisRegister(registers[i]);
+            auto slot = static_cast<i64>(slots + i * 16);
+            if (registers[i] >= Utils::Reg::xmm0) {
+                code.emit(ZYDIS_MNEMONIC_MOVAPS, { C::mem(ZYDIS_REGISTER_RSP, slot, 16), C::reg(reg) });
+            }
+            else if (auto pushed = pushedAt(reg)) {
+                code.emit(ZYDIS_MNEMONIC_MOV, { rax, C::mem(ZYDIS_REGISTER_RBX, *pushed, 8) });
+                code.emit(ZYDIS_MNEMONIC_MOV, { C::mem(ZYDIS_REGISTER_RSP, slot, 8), rax });
+            }
+            else {
+                code.emit(ZYDIS_MNEMONIC_MOV, { C::mem(ZYDIS_REGISTER_RSP, slot, 8), C::reg(reg) });
+            }
+        }
+
+        code.emit(ZYDIS_MNEMONIC_MOV, { rcx, rsp });
+        code.emit(ZYDIS_MNEMONIC_ADD, { rcx, C::imm(static_cast<i64>(slots)) });
+        code.emit(ZYDIS_MNEMONIC_MOV, { rdx, second });
+        code.emit(ZYDIS_MNEMONIC_MOV, { r8, rbx });
+        code.emit(ZYDIS_MNEMONIC_CALL, { target });
+
+        // Restore the volatile XMM registers first, the requested ones are written over them.
+        for (size_t i = 0; i < VOLATILE_XMM; i++) {
+            auto xmm = static_cast<ZydisRegister>(ZYDIS_REGISTER_XMM0 + i);
+            code.emit(ZYDIS_MNEMONIC_MOVAPS, { C::reg(xmm), C::mem(ZYDIS_REGISTER_RSP, static_cast<i64>(saved + i * 16), 16) });
+        }
+        for (size_t i = 0; i < registers.size(); i++) {
+            auto reg = zydisRegister(registers[i]);
+            auto slot = static_cast<i64>(slots + i * 16);
+            if (registers[i] >= Utils::Reg::xmm0) {
+                code.emit(ZYDIS_MNEMONIC_MOVAPS, { C::reg(reg), C::mem(ZYDIS_REGISTER_RSP, slot, 16) });
+            }
+            else if (auto pushed = pushedAt(reg)) {
+                code.emit(ZYDIS_MNEMONIC_MOV, { rax, C::mem(ZYDIS_REGISTER_RSP, slot, 8) });
+                code.emit(ZYDIS_MNEMONIC_MOV, { C::mem(ZYDIS_REGISTER_RBX, *pushed, 8), rax });
+            }
+            else {
+                code.emit(ZYDIS_MNEMONIC_MOV, { C::reg(reg), C::mem(ZYDIS_REGISTER_RSP, slot, 8) });
+            }
+        }
+
+        code.emit(ZYDIS_MNEMONIC_MOV, { rsp, rbx });
+        code.emit(ZYDIS_MNEMONIC_POP, { rbx });
+        for (auto it = VOLATILE.rbegin(); it != VOLATILE.rend(); it++) {
+            code.emit(ZYDIS_MNEMONIC_POP, { C::reg(*it) });
+        }
+        code.emit(ZYDIS_MNEMONIC_POPFQ, {});
+        return code;
+    }
+}
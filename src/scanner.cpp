@@ -0,0 +1,822 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string_view>
+#include <span>
+#include <bit>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+
+#include "scanner.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SCANNER_X64 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// GCC and Clang refuse to inline AVX2 intrinsics into functions that are not compiled
+// for AVX2, MSVC accepts them anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define SCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCANNER_TARGET_AVX2
+#endif
+
+namespace
+{
+    /**
+     * @brief Matches the pattern from one of its gaps onwards.
+     * @details Compares the bytes up to the next gap, then tries every length of that
+     *      gap from short to long. Gaps are bounded and few, so the backtracking stays
+     *      cheap.
+     *
+     * @param start Start of the candidate match.
+     * @param end End of the readable memory.
+     * @param pattern Compiled pattern.
+     * @param gap Index of the gap the comparison continues behind, 0 for the head.
+     * @param shift Number of extra bytes taken by the previous gaps.
+     * @param taken Receives the extra bytes taken by every gap, may be nullptr.
+     * @return true if the rest of the pattern matches.
+     */
+    bool matchFrom(const u8* start, const u8* end, const Utils::PatternView& pattern, size_t gap, size_t shift, u32* taken)
+    {
+        size_t begin = gap == 0 ? 0 : pattern.gaps[gap - 1].position;
+        size_t finish = gap < pattern.gaps.size() ? pattern.gaps[gap].position : pattern.size();
+        if (static_cast<size_t>(end - start) < shift + pattern.size()) {
+            return false;
+        }
+        const u8* data = start + shift;
+        for (size_t j = begin; j < finish; j++) {
+            if ((data[j] & pattern.mask[j]) != (pattern.bytes[j] & pattern.mask[j])) {
+                return false;
+            }
+        }
+        for (const auto& set : pattern.sets) {
+            if (set.position >= begin && set.position < finish && !set.values.contains(data[set.position])) {
+                return false;
+            }
+        }
+        if (gap == pattern.gaps.size()) {
+            return true;
+        }
+        for (u32 extra = 0; extra <= pattern.gaps[gap].extra; extra++) {
+            if (taken != nullptr) {
+                taken[gap] = extra;
+            }
+            if (matchFrom(start, end, pattern, gap + 1, shift + extra, taken)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Verifies the parts of a pattern the compare order does not cover.
+     * @details The compare order only holds the bytes and masks of the head, byte sets
+     *      and everything behind the first bounded gap are checked here.
+     *
+     * @param start Start of a candidate whose head matches.
+     * @param end End of the readable memory.
+     * @param pattern Compiled pattern.
+     * @return true if the whole pattern matches.
+     */
+    bool complete(const u8* start, const u8* end, const Utils::PatternView& pattern)
+    {
+        return pattern.simple() || matchFrom(start, end, pattern, 0, 0, nullptr);
+    }
+
+    /**
+     * @brief Checks if the pattern matches at the given location, rarest bytes first.
+     *
+     * @param data Start of the candidate match, must have at least `pattern.size()`
+     *      readable bytes.
+     * @param prepared Prepared pattern.
+     * @param skip Number of leading entries of the compare order that are already known
+     *      to match.
+     * @return true if every non-wildcard byte matches.
+     */
+    bool matchAt(const u8* data, const Utils::PreparedPattern& prepared, size_t skip = 0)
+    {
+        const auto& pattern = prepared.pattern;
+        for (size_t k = skip; k < prepared.order.size(); k++) {
+            u32 j = prepared.order[k];
+            if ((data[j] & pattern.mask[j]) != (pattern.bytes[j] & pattern.mask[j])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Verifies the positions an anchor search flagged, lowest first.
+     *
+     * @param candidates Bit i set if the anchor byte matched for the start `base + i`.
+     * @param base Start of the first candidate position.
+     * @param end End of the readable memory.
+     * @param prepared Prepared pattern, anchored.
+     * @return const u8* pointing to the first candidate that matches or nullptr.
+     */
+    const u8* verifyCandidates(u64 candidates, const u8* base, const u8* end, const Utils::PreparedPattern& prepared)
+    {
+        for (; candidates != 0; candidates &= candidates - 1) {
+            const u8* start = base + std::countr_zero(candidates);
+            if (matchAt(start, prepared, 1) && complete(start, end, prepared.pattern)) {
+                return start;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Size of the chunks the parallel scanners split the memory into.
+     */
+    constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    /**
+     * @brief A piece of a memory region handed to one worker.
+     * @details Matches have to start in [begin, end), the worker may read up to `limit`
+     *      so matches that start near the end of the chunk are not cut off.
+     */
+    struct Chunk {
+        const u8* begin;
+        const u8* end;
+        const u8* limit;
+        const u8* regionEnd;
+    };
+
+    /**
+     * @brief Splits memory regions into overlapping chunks.
+     *
+     * @param regions Memory regions ordered by address.
+     * @param overlap Number of bytes a chunk reaches into the next one, at least the
+     *      longest pattern minus one.
+     * @return std::vector<Chunk> ordered by address.
+     */
+    std::vector<Chunk> splitChunks(std::span<const std::span<const u8>> regions, size_t overlap)
+    {
+        std::vector<Chunk> chunks;
+        for (const auto& region : regions) {
+            const u8* regionEnd = region.data() + region.size();
+            for (size_t offset = 0; offset < region.size(); offset += CHUNK_SIZE) {
+                const u8* begin = region.data() + offset;
+                const u8* end = begin + std::min(CHUNK_SIZE, region.size() - offset);
+                const u8* limit = end + std::min(overlap, static_cast<size_t>(regionEnd - end));
+                chunks.push_back({ begin, end, limit, regionEnd });
+            }
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief Runs `worker` on up to one thread per hardware thread, including the caller.
+     *
+     * @param jobs Number of independent jobs, no more threads than jobs are started.
+     * @param threads Maximum number of threads, 0 uses one per hardware thread.
+     * @param worker Function that keeps pulling jobs until none are left.
+     */
+    template <typename Worker>
+    void runWorkers(size_t jobs, u32 threads, Worker&& worker)
+    {
+        size_t count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        count = std::min(count, jobs);
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < count; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Lowers `target` to `value` if `value` is smaller.
+     */
+    void atomicMin(std::atomic<uintptr_t>& target, uintptr_t value)
+    {
+        uintptr_t current = target.load(std::memory_order_relaxed);
+        while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Finds the next hit of a pattern that starts inside a chunk.
+     *
+     * @param prepared Prepared pattern to look for.
+     * @param from First position to consider, inside the chunk.
+     * @param chunk Chunk that owns the hit.
+     * @param mode Scanner implementation to use.
+     * @return const u8* pointing to the hit or nullptr if none starts in [from, chunk.end).
+     */
+    const u8* nextHit(const Utils::PreparedPattern& prepared, const u8* from, const Chunk& chunk, Utils::ScanMode mode)
+    {
+        const u8* hit = Utils::scan(std::span<const u8>(from, chunk.limit), prepared, mode);
+        return hit != nullptr && hit < chunk.end ? hit : nullptr;
+    }
+
+#if defined(SCANNER_X64)
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        bool osxsave = (ecx & (1u << 27)) != 0;
+        bool avx = (ecx & (1u << 28)) != 0;
+        if (!osxsave || !avx) {
+            return false;
+        }
+        unsigned xcr0Lo, xcr0Hi;
+        __asm__ volatile("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+        if ((xcr0Lo & 0x6) != 0x6) {
+            return false;
+        }
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ebx & (1u << 5)) != 0;
+#endif
+    }
+#endif
+}
+
+namespace Utils
+{
+    Pattern compilePattern(std::string_view signature)
+    {
+        return parsePattern(signature);
+    }
+
+    bool matches(std::span<const u8> data, PatternView pattern)
+    {
+        return matchFrom(data.data(), data.data() + data.size(), pattern, 0, 0, nullptr);
+    }
+
+    std::optional<PatternMatch> match(std::span<const u8> data, PatternView pattern)
+    {
+        std::vector<u32> taken(pattern.gaps.size());
+        if (!matchFrom(data.data(), data.data() + data.size(), pattern, 0, 0, taken.data())) {
+            return std::nullopt;
+        }
+
+        PatternMatch result;
+        result.start = data.data();
+        result.length = pattern.size();
+        for (u32 extra : taken) {
+            result.length += extra;
+        }
+        for (const auto& capture : pattern.captures) {
+            size_t shift = 0;
+            for (size_t i = 0; i < pattern.gaps.size() && pattern.gaps[i].position <= capture.position; i++) {
+                shift += taken[i];
+            }
+            result.captures.push_back({ data.data() + shift + capture.position, capture.size, capture.next });
+        }
+        return result;
+    }
+
+    std::optional<u64> PatternMatch::target(size_t index) const
+    {
+        if (index >= captures.size()) {
+            return std::nullopt;
+        }
+        const auto& capture = captures[index];
+        i64 displacement;
+        switch (capture.size) {
+        case 1:
+            displacement = static_cast<i8>(capture.address[0]);
+            break;
+        case 2: {
+            i16 value;
+            std::memcpy(&value, capture.address, sizeof(value));
+            displacement = value;
+            break;
+        }
+        case 4: {
+            i32 value;
+            std::memcpy(&value, capture.address, sizeof(value));
+            displacement = value;
+            break;
+        }
+        default:
+            return std::nullopt;
+        }
+        return reinterpret_cast<u64>(capture.address) + capture.size + capture.next + displacement;
+    }
+
+    ScanMode detectScanMode()
+    {
+#if defined(SCANNER_X64)
+        static const ScanMode mode = cpuHasAvx2() ? ScanMode::Avx2 : ScanMode::Sse2;
+        return mode;
+#else
+        return ScanMode::Scalar;
+#endif
+    }
+
+    const char* scanModeName(ScanMode mode)
+    {
+        switch (mode) {
+        case ScanMode::Avx2:
+            return "AVX2";
+        case ScanMode::Sse2:
+            return "SSE2";
+        case ScanMode::Scalar:
+        default:
+            return "Scalar";
+        }
+    }
+
+    ByteFrequency sampleFrequency(std::span<const std::span<const u8>> regions)
+    {
+        // Every 64 KiB page run contributes its first 4 KiB, plenty to tell common
+        // opcode bytes from rare ones without reading the whole image.
+        constexpr size_t STRIDE = 64 * 1024;
+        constexpr size_t SAMPLE = 4 * 1024;
+
+        ByteFrequency frequency;
+        frequency.fill(1);
+        for (const auto& region : regions) {
+            for (size_t offset = 0; offset < region.size(); offset += STRIDE) {
+                size_t count = std::min(SAMPLE, region.size() - offset);
+                for (u8 byte : region.subspan(offset, count)) {
+                    frequency[byte]++;
+                }
+            }
+        }
+        return frequency;
+    }
+
+    PreparedPattern prepare(PatternView pattern, const ByteFrequency& frequency)
+    {
+        PreparedPattern prepared;
+        prepared.pattern = pattern;
+        for (u32 j = 0; j < pattern.head(); j++) {
+            if (pattern.mask[j] != 0) {
+                prepared.order.push_back(j);
+            }
+        }
+        // Exact bytes by rarity, partially masked bytes after them.
+        std::stable_sort(prepared.order.begin(), prepared.order.end(), [&](u32 a, u32 b) {
+            bool exactA = pattern.mask[a] == 0xFF;
+            bool exactB = pattern.mask[b] == 0xFF;
+            if (exactA != exactB) {
+                return exactA;
+            }
+            return exactA && frequency[pattern.bytes[a]] < frequency[pattern.bytes[b]];
+        });
+        prepared.anchored = !prepared.order.empty() && pattern.mask[prepared.order[0]] == 0xFF;
+        return prepared;
+    }
+
+    PreparedPattern::PreparedPattern(PatternView pattern)
+    {
+        ByteFrequency uniform;
+        uniform.fill(1);
+        *this = prepare(pattern, uniform);
+    }
+
+    const u8* scanScalar(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        size_t size = prepared.pattern.size();
+        if (size == 0 || region.size() < size) {
+            return nullptr;
+        }
+        const u8* data = region.data();
+        size_t last = region.size() - size;
+
+        if (!prepared.anchored) {
+            for (size_t i = 0; i <= last; i++) {
+                if (matchAt(&data[i], prepared) && complete(&data[i], data + region.size(), prepared.pattern)) {
+                    return &data[i];
+                }
+            }
+            return nullptr;
+        }
+
+        // Jump from one occurrence of the rarest byte to the next and only verify there.
+        u32 anchor = prepared.order[0];
+        u8 value = prepared.pattern.bytes[anchor];
+        const u8* current = data + anchor;
+        const u8* stop = data + last + anchor + 1;
+        while (current < stop) {
+            current = static_cast<const u8*>(std::memchr(current, value, stop - current));
+            if (current == nullptr) {
+                break;
+            }
+            const u8* start = current - anchor;
+            if (matchAt(start, prepared, 1) && complete(start, data + region.size(), prepared.pattern)) {
+                return start;
+            }
+            current++;
+        }
+        return nullptr;
+    }
+
+#if defined(SCANNER_X64)
+    const u8* scanSse2(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        const auto& pattern = prepared.pattern;
+        size_t size = pattern.size();
+        if (size == 0 || region.size() < size) {
+            return nullptr;
+        }
+        const u8* data = region.data();
+        const u8* end = data + region.size();
+        size_t last = region.size() - size;
+        size_t i = 0;
+
+        if (prepared.anchored) {
+            // Skip 64 positions at a time until the rarest byte shows up, only then
+            // narrow the candidates down with the second rarest byte and verify them.
+            u32 anchor = prepared.order[0];
+            __m128i needle = _mm_set1_epi8(static_cast<char>(pattern.bytes[anchor]));
+            u32 second = prepared.order.size() > 1 ? prepared.order[1] : anchor;
+            __m128i filter = _mm_set1_epi8(static_cast<char>(pattern.mask[second]));
+            __m128i expected = _mm_set1_epi8(static_cast<char>(pattern.bytes[second] & pattern.mask[second]));
+            for (; i + 63 <= last; i += 64) {
+                const u8* base = &data[i + anchor];
+                __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base)), needle);
+                __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base + 16)), needle);
+                __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base + 32)), needle);
+                __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(base + 48)), needle);
+                if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3))) == 0) {
+                    continue;
+                }
+                if (second != anchor) {
+                    const u8* next = &data[i + second];
+                    e0 = _mm_and_si128(e0, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next)), filter), expected));
+                    e1 = _mm_and_si128(e1, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next + 16)), filter), expected));
+                    e2 = _mm_and_si128(e2, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next + 32)), filter), expected));
+                    e3 = _mm_and_si128(e3, _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(next + 48)), filter), expected));
+                }
+                u64 candidates = static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(e0))) |
+                    static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(e1))) << 16 |
+                    static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(e2))) << 32 |
+                    static_cast<u64>(static_cast<u32>(_mm_movemask_epi8(e3))) << 48;
+                if (const u8* hit = verifyCandidates(candidates, &data[i], end, prepared)) {
+                    return hit;
+                }
+            }
+            return scanScalar(region.subspan(i), prepared);
+        }
+
+        // Each iteration tests the 16 candidate positions i..i+15 byte by byte.
+        // Candidates drop out as soon as one of their bytes mismatches.
+        for (; i + 15 <= last; i += 16) {
+            u32 candidates = 0xFFFF;
+            for (u32 j : prepared.order) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i + j]));
+                __m128i mask = _mm_set1_epi8(static_cast<char>(pattern.mask[j]));
+                __m128i value = _mm_set1_epi8(static_cast<char>(pattern.bytes[j] & pattern.mask[j]));
+                __m128i eq = _mm_cmpeq_epi8(_mm_and_si128(chunk, mask), value);
+                candidates &= static_cast<u32>(_mm_movemask_epi8(eq));
+                if (candidates == 0) {
+                    break;
+                }
+            }
+            for (; candidates != 0; candidates &= candidates - 1) {
+                const u8* start = &data[i + std::countr_zero(candidates)];
+                if (complete(start, end, pattern)) {
+                    return start;
+                }
+            }
+        }
+
+        return scanScalar(region.subspan(i), prepared);
+    }
+
+    SCANNER_TARGET_AVX2
+    const u8* scanAvx2(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        const auto& pattern = prepared.pattern;
+        size_t size = pattern.size();
+        if (size == 0 || region.size() < size) {
+            return nullptr;
+        }
+        const u8* data = region.data();
+        const u8* end = data + region.size();
+        size_t last = region.size() - size;
+        size_t i = 0;
+
+        if (prepared.anchored) {
+            // Same as the SSE2 variant, 128 positions at a time.
+            u32 anchor = prepared.order[0];
+            __m256i needle = _mm256_set1_epi8(static_cast<char>(pattern.bytes[anchor]));
+            u32 second = prepared.order.size() > 1 ? prepared.order[1] : anchor;
+            __m256i filter = _mm256_set1_epi8(static_cast<char>(pattern.mask[second]));
+            __m256i expected = _mm256_set1_epi8(static_cast<char>(pattern.bytes[second] & pattern.mask[second]));
+            for (; i + 127 <= last; i += 128) {
+                const u8* base = &data[i + anchor];
+                __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base)), needle);
+                __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + 32)), needle);
+                __m256i e2 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + 64)), needle);
+                __m256i e3 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + 96)), needle);
+                __m256i any = _mm256_or_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e2, e3));
+                if (_mm256_testz_si256(any, any)) {
+                    continue;
+                }
+                if (second != anchor) {
+                    const u8* next = &data[i + second];
+                    e0 = _mm256_and_si256(e0, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(next)), filter), expected));
+                    e1 = _mm256_and_si256(e1, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(next + 32)), filter), expected));
+                    e2 = _mm256_and_si256(e2, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(next + 64)), filter), expected));
+                    e3 = _mm256_and_si256(e3, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(next + 96)), filter), expected));
+                }
+                u64 low = static_cast<u64>(static_cast<u32>(_mm256_movemask_epi8(e0))) |
+                    static_cast<u64>(static_cast<u32>(_mm256_movemask_epi8(e1))) << 32;
+                u64 high = static_cast<u64>(static_cast<u32>(_mm256_movemask_epi8(e2))) |
+                    static_cast<u64>(static_cast<u32>(_mm256_movemask_epi8(e3))) << 32;
+                if (const u8* hit = verifyCandidates(low, &data[i], end, prepared)) {
+                    return hit;
+                }
+                if (const u8* hit = verifyCandidates(high, &data[i + 64], end, prepared)) {
+                    return hit;
+                }
+            }
+            return scanSse2(region.subspan(i), prepared);
+        }
+
+        // Same as the SSE2 variant, but with 32 candidate positions per iteration.
+        for (; i + 31 <= last; i += 32) {
+            u32 candidates = 0xFFFFFFFF;
+            for (u32 j : prepared.order) {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i + j]));
+                __m256i mask = _mm256_set1_epi8(static_cast<char>(pattern.mask[j]));
+                __m256i value = _mm256_set1_epi8(static_cast<char>(pattern.bytes[j] & pattern.mask[j]));
+                __m256i eq = _mm256_cmpeq_epi8(_mm256_and_si256(chunk, mask), value);
+                candidates &= static_cast<u32>(_mm256_movemask_epi8(eq));
+                if (candidates == 0) {
+                    break;
+                }
+            }
+            for (; candidates != 0; candidates &= candidates - 1) {
+                const u8* start = &data[i + std::countr_zero(candidates)];
+                if (complete(start, end, pattern)) {
+                    return start;
+                }
+            }
+        }
+
+        return scanSse2(region.subspan(i), prepared);
+    }
+#else
+    const u8* scanSse2(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        return scanScalar(region, prepared);
+    }
+
+    const u8* scanAvx2(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        return scanScalar(region, prepared);
+    }
+#endif
+
+    const u8* scan(std::span<const u8> region, const PreparedPattern& prepared, ScanMode mode)
+    {
+        switch (mode) {
+        case ScanMode::Avx2:
+            return scanAvx2(region, prepared);
+        case ScanMode::Sse2:
+            return scanSse2(region, prepared);
+        case ScanMode::Scalar:
+        default:
+            return scanScalar(region, prepared);
+        }
+    }
+
+    const u8* scan(std::span<const u8> region, const PreparedPattern& prepared)
+    {
+        return scan(region, prepared, detectScanMode());
+    }
+
+    const u8* scanParallel(std::span<const u8> region, const PreparedPattern& prepared, u32 threads)
+    {
+        if (prepared.pattern.size() == 0) {
+            return nullptr;
+        }
+        auto regions = std::span<const std::span<const u8>>(&region, 1);
+        auto chunks = splitChunks(regions, prepared.pattern.maxSize() - 1);
+        ScanMode mode = detectScanMode();
+        std::atomic<size_t> next = 0;
+        std::atomic<uintptr_t> best = UINTPTR_MAX;
+
+        runWorkers(chunks.size(), threads, [&]() {
+            size_t index;
+            while ((index = next.fetch_add(1, std::memory_order_relaxed)) < chunks.size()) {
+                const auto& chunk = chunks[index];
+                // Chunks are handed out in address order, once a hit is known below this
+                // chunk every remaining chunk is pointless.
+                if (reinterpret_cast<uintptr_t>(chunk.begin) >= best.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                auto hit = scan(std::span<const u8>(chunk.begin, chunk.limit), prepared, mode);
+                if (hit != nullptr) {
+                    atomicMin(best, reinterpret_cast<uintptr_t>(hit));
+                }
+            }
+        });
+
+        uintptr_t hit = best.load();
+        return hit == UINTPTR_MAX ? nullptr : reinterpret_cast<const u8*>(hit);
+    }
+
+    size_t MultiScanner::add(PatternView pattern)
+    {
+        entries.emplace_back(pattern);
+        return entries.size() - 1;
+    }
+
+    void MultiScanner::build(std::span<const std::span<const u8>> regions)
+    {
+        if (!frequency) {
+            frequency = sampleFrequency(regions);
+        }
+        for (auto& entry : entries) {
+            entry = prepare(entry.pattern, *frequency);
+        }
+    }
+
+    std::vector<const u8*> MultiScanner::scan(std::span<const u8> region)
+    {
+        return scan(std::span<const std::span<const u8>>(&region, 1));
+    }
+
+    std::vector<const u8*> MultiScanner::scan(std::span<const std::span<const u8>> regions)
+    {
+        build(regions);
+        ScanMode mode = detectScanMode();
+
+        std::vector<std::atomic<uintptr_t>> best(entries.size());
+        size_t longest = 1;
+        for (u32 id = 0; id < entries.size(); id++) {
+            best[id] = UINTPTR_MAX;
+            longest = std::max(longest, entries[id].pattern.maxSize());
+        }
+
+        // Checks whether every pattern already has a hit below `position`.
+        auto settled = [&](const u8* position) {
+            for (u32 id = 0; id < entries.size(); id++) {
+                if (best[id].load(std::memory_order_relaxed) > reinterpret_cast<uintptr_t>(position)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        auto chunks = splitChunks(regions, longest - 1);
+        std::atomic<size_t> next = 0;
+
+        runWorkers(chunks.size(), threads, [&]() {
+            size_t index;
+            while ((index = next.fetch_add(1, std::memory_order_relaxed)) < chunks.size()) {
+                const auto& chunk = chunks[index];
+                if (settled(chunk.begin)) {
+                    break;
+                }
+                // The chunk stays in cache while every pattern is scanned for in turn.
+                for (u32 id = 0; id < entries.size(); id++) {
+                    if (reinterpret_cast<uintptr_t>(chunk.begin) >= best[id].load(std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    if (const u8* hit = nextHit(entries[id], chunk.begin, chunk, mode)) {
+                        atomicMin(best[id], reinterpret_cast<uintptr_t>(hit));
+                    }
+                }
+            }
+        });
+
+        std::vector<const u8*> hits;
+        for (const auto& hit : best) {
+            uintptr_t value = hit.load();
+            hits.push_back(value == UINTPTR_MAX ? nullptr : reinterpret_cast<const u8*>(value));
+        }
+        return hits;
+    }
+
+    std::vector<std::vector<const u8*>> MultiScanner::scanAll(std::span<const std::span<const u8>> regions, std::span<const size_t> limits)
+    {
+        build(regions);
+        ScanMode mode = detectScanMode();
+
+        size_t longest = 1;
+        std::vector<size_t> wanted(entries.size(), SIZE_MAX);
+        std::vector<std::atomic<uintptr_t>> horizon(entries.size());
+        for (u32 id = 0; id < entries.size(); id++) {
+            longest = std::max(longest, entries[id].pattern.maxSize());
+            if (id < limits.size()) {
+                wanted[id] = limits[id];
+            }
+            horizon[id] = wanted[id] == 0 ? 0 : UINTPTR_MAX;
+        }
+
+        // `horizon` holds the address of the last wanted hit among the lowest hits found
+        // so far. Nothing at or above it can be one of the first hits any more, and every
+        // hit below it lies in a chunk that was handed out earlier and is scanned fully.
+        std::vector<std::vector<uintptr_t>> lowest(entries.size());
+        std::mutex mutex;
+        auto record = [&](u32 id, const u8* hit) {
+            if (wanted[id] == SIZE_MAX) {
+                return;
+            }
+            std::lock_guard lock(mutex);
+            auto& list = lowest[id];
+            auto value = reinterpret_cast<uintptr_t>(hit);
+            list.insert(std::upper_bound(list.begin(), list.end(), value), value);
+            if (list.size() > wanted[id]) {
+                list.pop_back();
+            }
+            if (list.size() == wanted[id]) {
+                horizon[id].store(list.back(), std::memory_order_relaxed);
+            }
+        };
+
+        // Checks whether every pattern already has all wanted hits below `position`.
+        auto settled = [&](const u8* position) {
+            for (u32 id = 0; id < entries.size(); id++) {
+                if (horizon[id].load(std::memory_order_relaxed) > reinterpret_cast<uintptr_t>(position)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Every chunk records its own hits, merging them in chunk order keeps them sorted.
+        auto chunks = splitChunks(regions, longest - 1);
+        std::vector<std::vector<std::pair<u32, const u8*>>> chunkHits(chunks.size());
+        std::atomic<size_t> next = 0;
+
+        runWorkers(chunks.size(), threads, [&]() {
+            size_t index;
+            while ((index = next.fetch_add(1, std::memory_order_relaxed)) < chunks.size()) {
+                const auto& chunk = chunks[index];
+                if (settled(chunk.begin)) {
+                    break;
+                }
+                for (u32 id = 0; id < entries.size(); id++) {
+                    for (const u8* hit = nextHit(entries[id], chunk.begin, chunk, mode);
+                        hit != nullptr && reinterpret_cast<uintptr_t>(hit) < horizon[id].load(std::memory_order_relaxed);
+                        hit = nextHit(entries[id], hit + 1, chunk, mode)) {
+                        chunkHits[index].emplace_back(id, hit);
+                        record(id, hit);
+                    }
+                }
+            }
+        });
+
+        std::vector<std::vector<const u8*>> hits(entries.size());
+        for (const auto& list : chunkHits) {
+            for (const auto& [id, start] : list) {
+                if (hits[id].size() < wanted[id]) {
+                    hits[id].push_back(start);
+                }
+            }
+        }
+        return hits;
+    }
+}
@@ -0,0 +1,309 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <string>
+#include <span>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "suffixarray.hpp"
+
+namespace
+{
+    constexpr char CACHE_MAGIC[8] = { 'T', 'Q', '2', 'F', 'I', 'X', 'S', 'A' };
+    constexpr u32 CACHE_VERSION = 1;
+
+    /**
+     * @brief Builds a suffix array using induced sorting (SA-IS).
+     * @details Suffixes are classified as S or L type, the leftmost S suffixes (LMS)
+     *      are sorted by recursing on a reduced string of their ranks and every other
+     *      suffix is then induced from them in two linear passes.
+     *
+     * @param s Symbols of the string, each in [0, upper].
+     * @param upper Largest symbol.
+     * @return std::vector<i32> containing the suffix array.
+     */
+    template <typename T>
+    std::vector<i32> saIs(std::span<const T> s, i32 upper)
+    {
+        i32 n = static_cast<i32>(s.size());
+        if (n == 0) {
+            return {};
+        }
+        if (n == 1) {
+            return { 0 };
+        }
+        if (n == 2) {
+            return s[0] < s[1] ? std::vector<i32>{ 0, 1 } : std::vector<i32>{ 1, 0 };
+        }
+
+        std::vector<i32> sa(n);
+        std::vector<bool> ls(n);    // true for S type suffixes
+        for (i32 i = n - 2; i >= 0; i--) {
+            ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+        }
+
+        // Bucket boundaries: sumL[c] is the start of the L bucket of c, sumS[c] the
+        // start of its S part.
+        std::vector<i32> sumL(upper + 2), sumS(upper + 2);
+        for (i32 i = 0; i < n; i++) {
+            if (!ls[i]) {
+                sumS[s[i]]++;
+            }
+            else {
+                sumL[s[i] + 1]++;
+            }
+        }
+        for (i32 i = 0; i <= upper; i++) {
+            sumS[i] += sumL[i];
+            if (i < upper) {
+                sumL[i + 1] += sumS[i];
+            }
+        }
+
+        auto induce = [&](const std::vector<i32>& lms) {
+            std::fill(sa.begin(), sa.end(), -1);
+            std::vector<i32> buffer(upper + 2);
+            std::copy(sumS.begin(), sumS.end(), buffer.begin());
+            for (i32 d : lms) {
+                if (d != n) {
+                    sa[buffer[s[d]]++] = d;
+                }
+            }
+            std::copy(sumL.begin(), sumL.end(), buffer.begin());
+            sa[buffer[s[n - 1]]++] = n - 1;
+            for (i32 i = 0; i < n; i++) {
+                i32 v = sa[i];
+                if (v >= 1 && !ls[v - 1]) {
+                    sa[buffer[s[v - 1]]++] = v - 1;
+                }
+            }
+            std::copy(sumL.begin(), sumL.end(), buffer.begin());
+            for (i32 i = n - 1; i >= 0; i--) {
+                i32 v = sa[i];
+                if (v >= 1 && ls[v - 1]) {
+                    sa[--buffer[s[v - 1] + 1]] = v - 1;
+                }
+            }
+        };
+
+        std::vector<i32> lmsMap(n + 1, -1);
+        std::vector<i32> lms;
+        for (i32 i = 1; i < n; i++) {
+            if (!ls[i - 1] && ls[i]) {
+                lmsMap[i] = static_cast<i32>(lms.size());
+                lms.push_back(i);
+            }
+        }
+        i32 m = static_cast<i32>(lms.size());
+
+        induce(lms);
+
+        if (m != 0) {
+            std::vector<i32> sortedLms;
+            sortedLms.reserve(m);
+            for (i32 v : sa) {
+                if (lmsMap[v] != -1) {
+                    sortedLms.push_back(v);
+                }
+            }
+
+            // Name the LMS substrings, equal substrings share a name.
+            std::vector<i32> reduced(m);
+            i32 reducedUpper = 0;
+            reduced[lmsMap[sortedLms[0]]] = 0;
+            for (i32 i = 1; i < m; i++) {
+                i32 l = sortedLms[i - 1];
+                i32 r = sortedLms[i];
+                i32 endL = (lmsMap[l] + 1 < m) ? lms[lmsMap[l] + 1] : n;
+                i32 endR = (lmsMap[r] + 1 < m) ? lms[lmsMap[r] + 1] : n;
+                bool same = true;
+                if (endL - l != endR - r) {
+                    same = false;
+                }
+                else {
+                    while (l < endL && s[l] == s[r]) {
+                        l++;
+                        r++;
+                    }
+                    if (l == n || s[l] != s[r]) {
+                        same = false;
+                    }
+                }
+                if (!same) {
+                    reducedUpper++;
+                }
+                reduced[lmsMap[sortedLms[i]]] = reducedUpper;
+            }
+
+            auto reducedSa = saIs<i32>(reduced, reducedUpper);
+            for (i32 i = 0; i < m; i++) {
+                sortedLms[i] = lms[reducedSa[i]];
+            }
+            induce(sortedLms);
+        }
+        return sa;
+    }
+}
+
+namespace Utils
+{
+    SuffixArray::SuffixArray(std::span<const u8> text) : data(text)
+    {
+        auto built = saIs<u8>(text, 255);
+        sa.assign(built.begin(), built.end());
+    }
+
+    SuffixArray::SuffixArray(std::span<const u8> text, std::vector<u32> suffixes) : data(text), sa(std::move(suffixes))
+    {
+    }
+
+    std::span<const u32> SuffixArray::find(std::span<const u8> needle) const
+    {
+        // Compares the suffix at `position` with the needle, only the first
+        // needle.size() bytes matter.
+        auto compare = [&](u32 position) {
+            size_t length = std::min(needle.size(), data.size() - position);
+            int result = std::memcmp(data.data() + position, needle.data(), length);
+            if (result != 0) {
+                return result;
+            }
+            return length < needle.size() ? -1 : 0;
+        };
+        auto first = std::partition_point(sa.begin(), sa.end(), [&](u32 position) {
+            return compare(position) < 0;
+        });
+        auto last = std::partition_point(first, sa.end(), [&](u32 position) {
+            return compare(position) == 0;
+        });
+        return { first, last };
+    }
+
+    CodeIndex::CodeIndex(const ImageFile& image, const std::string& cachePath) : image(image)
+    {
+        for (const auto& section : image.sections()) {
+            segments.push_back({ static_cast<u32>(text.size()), section.rva, static_cast<u32>(section.bytes.size()) });
+            text.insert(text.end(), section.bytes.begin(), section.bytes.end());
+        }
+
+        loaded = !cachePath.empty() && load(cachePath);
+        if (!loaded) {
+            array = SuffixArray(text);
+            if (!cachePath.empty()) {
+                save(cachePath);
+            }
+        }
+    }
+
+    std::vector<u32> CodeIndex::find(PatternView pattern, size_t limit) const
+    {
+        // Look up the run of exact bytes with the fewest occurrences, runs behind a
+        // bounded gap have no fixed distance to the start.
+        std::span<const u32> candidates;
+        size_t runOffset = 0;
+        bool found = false;
+        for (size_t i = 0; i < pattern.head();) {
+            if (pattern.mask[i] != 0xFF) {
+                i++;
+                continue;
+            }
+            size_t end = i;
+            while (end < pattern.head() && pattern.mask[end] == 0xFF) {
+                end++;
+            }
+            auto occurrences = array.find(pattern.bytes.subspan(i, end - i));
+            if (!found || occurrences.size() < candidates.size()) {
+                candidates = occurrences;
+                runOffset = i;
+                found = true;
+            }
+            i = end;
+        }
+
+        std::vector<u32> hits;
+        for (u32 position : candidates) {
+            if (position < runOffset) {
+                continue;
+            }
+            u32 start = static_cast<u32>(position - runOffset);
+            auto segment = std::upper_bound(segments.begin(), segments.end(), start, [](u32 value, const Segment& seg) {
+                return value < seg.offset;
+            });
+            segment--;
+            if (start - segment->offset + pattern.size() > segment->size) {
+                continue;
+            }
+            if (Utils::matches(std::span<const u8>(text).subspan(start, segment->offset + segment->size - start), pattern)) {
+                hits.push_back(segment->rva + (start - segment->offset));
+                if (hits.size() >= limit) {
+                    break;
+                }
+            }
+        }
+        std::sort(hits.begin(), hits.end());
+        return hits;
+    }
+
+    bool CodeIndex::load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(CACHE_MAGIC)];
+        u32 header[4];
+        u64 size;
+        if (!file.read(magic, sizeof(magic)) || !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+            !file.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+            return false;
+        }
+        const auto& info = image.info();
+        if (std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || header[0] != CACHE_VERSION ||
+            header[1] != info.timeDateStamp || header[2] != info.checkSum || header[3] != info.sizeOfImage ||
+            size != text.size()) {
+            return false;
+        }
+
+        std::vector<u32> suffixes(text.size());
+        if (!file.read(reinterpret_cast<char*>(suffixes.data()), static_cast<std::streamsize>(suffixes.size() * sizeof(u32)))) {
+            return false;
+        }
+        array = SuffixArray(text, std::move(suffixes));
+        return true;
+    }
+
+    bool CodeIndex::save(const std::string& path) const
+    {
+        const auto& info = image.info();
+        u32 header[4] = { CACHE_VERSION, info.timeDateStamp, info.checkSum, info.sizeOfImage };
+        u64 size = text.size();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        auto suffixes = array.suffixes();
+        file.write(reinterpret_cast<const char*>(suffixes.data()), static_cast<std::streamsize>(suffixes.size() * sizeof(u32)));
+        return file.good();
+    }
+}
@@ -0,0 +1,348 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <windows.h>
+#include <tlhelp32.h>
+#include <vector>
+#include <cstring>
+#include <string>
+#include <format>
+#include <algorithm>
+
+#include "transaction.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    constexpr u32 FREEZE_ATTEMPTS = 16;
+}
+
+namespace Utils
+{
+    ThreadFreezer::ThreadFreezer()
+    {
+        DWORD process = GetCurrentProcessId();
+        DWORD self = GetCurrentThreadId();
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        std::vector<DWORD> ids;
+        THREADENTRY32 entry{};
+        entry.dwSize = sizeof(entry);
+        for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+            if (entry.th32OwnerProcessID == process && entry.th32ThreadID != self) {
+                ids.push_back(entry.th32ThreadID);
+            }
+        }
+        CloseHandle(snapshot);
+
+        threads.reserve(ids.size());
+        for (DWORD id : ids) {
+            HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_SET_CONTEXT, FALSE, id);
+            if (thread == nullptr) {
+                continue;
+            }
+            if (SuspendThread(thread) == static_cast<DWORD>(-1)) {
+                CloseHandle(thread);
+                continue;
+            }
+            // SuspendThread is asynchronous, fetching the context waits until the
+            // thread has actually stopped.
+            CONTEXT context{};
+            context.ContextFlags = CONTEXT_CONTROL;
+            u64 ip = GetThreadContext(thread, &context) ? context.Rip : 0;
+            threads.push_back({ thread, ip });
+        }
+    }
+
+    ThreadFreezer::~ThreadFreezer()
+    {
+        for (const auto& thread : threads) {
+            ResumeThread(thread.handle);
+            CloseHandle(thread.handle);
+        }
+    }
+
+    bool PatchTransaction::add(u64 address, Utils::PatternView pattern, std::string name)
+    {
+        if (applied || !pattern.simple() || pattern.size() == 0) {
+            return false;
+        }
+        if (name.empty()) {
+            name = std::format("patch @ {:#x}", address);
+        }
+        Write entry{ address, std::move(name), {}, {} };
+        auto target = reinterpret_cast<const u8*>(address);
+        entry.original.assign(target, target + pattern.size());
+        entry.patched = entry.original;
+        for (size_t i = 0; i < pattern.size(); i++) {
+            entry.patched[i] = (entry.patched[i] & ~pattern.mask[i]) | (pattern.bytes[i] & pattern.mask[i]);
+        }
+        writes.push_back(std::move(entry));
+        return true;
+    }
+
+    bool PatchTransaction::add(u64 address, std::span<const u8> bytes, std::string name)
+    {
+        if (applied || bytes.empty()) {
+            return false;
+        }
+        if (name.empty()) {
+            name = std::format("patch @ {:#x}", address);
+        }
+        Write entry{ address, std::move(name), {}, {} };
+        auto target = reinterpret_cast<const u8*>(address);
+        entry.original.assign(target, target + bytes.size());
+        entry.patched.assign(bytes.begin(), bytes.end());
+        writes.push_back(std::move(entry));
+        return true;
+    }
+
+    bool PatchTransaction::commit()
+    {
+        if (applied || writes.empty()) {
+            return applied;
+        }
+        std::sort(writes.begin(), writes.end(), [](const Write& a, const Write& b) {
+            return a.address < b.address;
+        });
+
+        // Overlapping writes cannot both be right, every write of a cluster of
+        // overlapping ones is dropped and the others go ahead.
+        std::vector<bool> conflicting(writes.size(), false);
+        u64 reach = 0;
+        size_t owner = 0;
+        for (size_t i = 0; i < writes.size(); i++) {
+            if (i != 0 && writes[i].address < reach) {
+                LOG("{:s} overlaps {:s}, both skipped", writes[i].name, writes[owner].name);
+                conflicting[i] = true;
+                conflicting[owner] = true;
+            }
+            if (writes[i].address + writes[i].patched.size() > reach) {
+                reach = writes[i].address + writes[i].patched.size();
+                owner = i;
+            }
+        }
+        drop(conflicting);
+        if (writes.empty()) {
+            return false;
+        }
+
+        coalesce();
+        applied = write(true);
+        return applied;
+    }
+
+    bool PatchTransaction::written(u64 address) const
+    {
+        return applied && std::any_of(writes.begin(), writes.end(), [address](const Write& entry) {
+            return entry.address == address;
+        });
+    }
+
+    void PatchTransaction::drop(const std::vector<bool>& rejected)
+    {
+        // Threads must not be moved into the copies of instructions that stay in place.
+        std::erase_if(redirects, [&](const auto& redirect) {
+            for (size_t i = 0; i < writes.size(); i++) {
+                if (rejected[i] && redirect.first >= writes[i].address && redirect.first < writes[i].address + writes[i].patched.size()) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        size_t kept = 0;
+        for (size_t i = 0; i < writes.size(); i++) {
+            if (rejected[i]) {
+                continue;
+            }
+            if (kept != i) {
+                writes[kept] = std::move(writes[i]);
+            }
+            kept++;
+        }
+        writes.resize(kept);
+    }
+
+    void PatchTransaction::coalesce()
+    {
+        // Coalesce the pages touched by the writes into runs of adjacent pages.
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        u64 pageSize = info.dwPageSize;
+        pages.clear();
+        for (const auto& entry : writes) {
+            u64 first = entry.address & ~(pageSize - 1);
+            u64 last = (entry.address + entry.patched.size() - 1) & ~(pageSize - 1);
+            if (!pages.empty() && first <= pages.back().first + pages.back().second) {
+                u64 end = std::max(pages.back().first + pages.back().second, last + pageSize);
+                pages.back().second = static_cast<size_t>(end - pages.back().first);
+            }
+            else {
+                pages.emplace_back(first, static_cast<size_t>(last + pageSize - first));
+            }
+        }
+    }
+
+    bool PatchTransaction::rollback()
+    {
+        if (!applied) {
+            return false;
+        }
+        applied = !write(false);
+        return !applied;
+    }
+
+    size_t PatchTransaction::owner(u64 address) const
+    {
+        auto next = std::upper_bound(writes.begin(), writes.end(), address, [](u64 address, const Write& entry) {
+            return address < entry.address;
+        });
+        return next == writes.begin() ? 0 : static_cast<size_t>(next - 1 - writes.begin());
+    }
+
+    size_t PatchTransaction::interrupted(const ThreadFreezer& freezer, bool patch, std::vector<bool>& busy) const
+    {
+        std::fill(busy.begin(), busy.end(), false);
+        size_t count = 0;
+        // The writes are sorted, find the last one starting before each instruction pointer.
+        for (const auto& thread : freezer.frozen()) {
+            auto next = std::upper_bound(writes.begin(), writes.end(), thread.ip, [](u64 ip, const Write& entry) {
+                return ip < entry.address;
+            });
+            if (next == writes.begin()) {
+                continue;
+            }
+            const auto& entry = *(next - 1);
+            if (thread.ip == entry.address || thread.ip >= entry.address + entry.patched.size()) {
+                continue;
+            }
+            bool redirected = patch && std::any_of(redirects.begin(), redirects.end(), [&](const auto& redirect) {
+                return redirect.first == thread.ip;
+            });
+            size_t index = static_cast<size_t>(next - 1 - writes.begin());
+            if (!redirected && !busy[index]) {
+                busy[index] = true;
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool PatchTransaction::write(bool patch)
+    {
+        // Everything is allocated up front, nothing may allocate while threads are frozen.
+        std::vector<DWORD> protections(pages.size());
+        std::vector<bool> busy(writes.size(), false);
+
+        // Writes that threads are still running through after the last attempt are
+        // dropped when patching. Undoing has to restore everything, it keeps waiting
+        // on every attempt and gives up as a whole.
+        size_t unlocked = 0;
+        size_t stuck = 0;
+        bool attempted = false;
+        for (u32 attempt = 0; attempt < FREEZE_ATTEMPTS && !attempted; attempt++) {
+            if (attempt != 0) {
+                Sleep(1);   // Let the threads run out of the patched code
+            }
+            ThreadFreezer freezer;
+            stuck = interrupted(freezer, patch, busy);
+            if (stuck != 0 && (!patch || attempt + 1 < FREEZE_ATTEMPTS || stuck == writes.size())) {
+                continue;
+            }
+            attempted = true;
+            for (; unlocked < pages.size(); unlocked++) {
+                auto [address, size] = pages[unlocked];
+                if (!VirtualProtect(reinterpret_cast<LPVOID>(address), size, PAGE_EXECUTE_READWRITE, &protections[unlocked])) {
+                    break;
+                }
+            }
+            if (unlocked == pages.size()) {
+                for (size_t i = 0; i < writes.size(); i++) {
+                    if (busy[i]) {
+                        continue;
+                    }
+                    const auto& bytes = patch ? writes[i].patched : writes[i].original;
+                    std::memcpy(reinterpret_cast<void*>(writes[i].address), bytes.data(), bytes.size());
+                }
+                // Threads inside displaced instructions continue at their copies. Undoing
+                // leaves threads in the copies alone, they stay valid.
+                for (const auto& thread : freezer.frozen()) {
+                    for (auto [from, to] : redirects) {
+                        if (!patch || thread.ip != from || busy[owner(from)]) {
+                            continue;
+                        }
+                        CONTEXT context{};
+                        context.ContextFlags = CONTEXT_CONTROL;
+                        if (GetThreadContext(thread.handle, &context)) {
+                            context.Rip = to;
+                            SetThreadContext(thread.handle, &context);
+                        }
+                        break;
+                    }
+                }
+            }
+            for (size_t i = 0; i < unlocked; i++) {
+                DWORD ignored;
+                VirtualProtect(reinterpret_cast<LPVOID>(pages[i].first), pages[i].second, protections[i], &ignored);
+            }
+            if (unlocked == pages.size()) {
+                // Flushed run by run, caves near distant sites can be gigabytes apart.
+                for (auto [address, size] : pages) {
+                    FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<LPCVOID>(address), size);
+                }
+                for (auto [address, size] : extra) {
+                    FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<LPCVOID>(address), size);
+                }
+            }
+        }
+
+        if (!attempted) {
+            if (patch) {
+                for (const auto& entry : writes) {
+                    LOG("Threads kept running inside {:s}, skipped", entry.name);
+                }
+            }
+            else {
+                LOG("Threads kept running inside the patched code, {} patches not reverted", writes.size());
+            }
+            return false;
+        }
+        if (unlocked != pages.size()) {
+            LOG("Failed to unprotect {:#x}, {} patches not {}", pages[unlocked].first, writes.size(), patch ? "applied" : "reverted");
+            return false;
+        }
+        if (stuck != 0) {
+            for (size_t i = 0; i < writes.size(); i++) {
+                if (busy[i]) {
+                    LOG("Threads kept running inside {:s}, skipped", writes[i].name);
+                }
+            }
+            drop(busy);
+            coalesce();
+        }
+        return true;
+    }
+}
@@ -23,15 +23,642 @@
  */
 
 #include <windows.h>
+#include <psapi.h>
 #include <vector>
 #include <format>
 #include <iostream>
-#include <sstream>
 #include <span>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <tuple>
 
 #include "utils.hpp"
+#include "cache.hpp"
+
+namespace
+{
+    struct PendingPatch {
+        Utils::ModuleInfo* module;
+        Utils::SignaturePatch sp;
+    };
+
+    struct PendingHook {
+        Utils::ModuleInfo* module;
+        Utils::SignatureHook hook;
+        Utils::HookCallback callback;
+    };
+
+    struct PendingCave {
+        Utils::ModuleInfo* module;
+        Utils::SignatureHook hook;
+        Utils::CaveCode code;
+    };
+
+    /**
+     * @brief A signature that needs to be resolved in a module.
+     */
+    struct Lookup {
+        Utils::PatternView pattern;
+        std::string_view text;
+        std::string section;
+        u32 match = 0;
+        bool unique = false;
+        Utils::Scope scope = Utils::Scope::Anywhere;
+        u64 offset = 0;     // Offset of the hook or patch from the hit
+        size_t group = 0;   // Alternatives of one hook or patch share a group, in priority order
+        bool skipped = false;
+        u64 address = 0;
+        size_t count = 0;   // Number of hits up to match + 2, 1 for cached lookups
+        bool cached = false;
+    };
+
+    /**
+     * @brief A module together with the signatures to resolve in it.
+     */
+    struct Target {
+        HMODULE address;
+        std::string name;
+        std::vector<Lookup> lookups;
+        size_t groups = 0;
+    };
+
+    /**
+     * @brief Where the alternatives of a hook or patch were placed, target and first lookup.
+     */
+    using Placement = std::vector<std::pair<size_t, size_t>>;
+
+    /**
+     * @brief Signature cache shared by the threads resolving different modules.
+     */
+    class SharedCache {
+    public:
+        explicit SharedCache(Utils::SignatureCache* cache) : cache(cache) {}
+
+        std::optional<u32> find(const Utils::CacheKey& key)
+        {
+            std::lock_guard lock(mutex);
+            return cache ? cache->find(key) : std::nullopt;
+        }
+
+        void store(const Utils::CacheKey& key, u32 rva)
+        {
+            std::lock_guard lock(mutex);
+            if (cache) {
+                cache->store(key, rva);
+            }
+        }
+
+        void erase(const Utils::CacheKey& key)
+        {
+            std::lock_guard lock(mutex);
+            if (cache) {
+                cache->erase(key);
+            }
+        }
+
+    private:
+        Utils::SignatureCache* cache;
+        std::mutex mutex;
+    };
+
+    /**
+     * @brief Parsed headers of a module and everything derived from them.
+     */
+    struct ModuleMap {
+        u32 timeDateStamp;
+        Utils::PeInfo info;
+        std::optional<Utils::FunctionIndex> functions;
+        std::vector<std::pair<std::string, std::vector<std::span<const u8>>>> regions;
+        std::vector<std::pair<std::string, Utils::ByteFrequency>> frequencies;
+    };
+
+    std::vector<PendingPatch> pendingPatches;
+    std::vector<PendingHook> pendingHooks;
+    std::vector<PendingCave> pendingCaves;
+    std::vector<std::unique_ptr<Utils::HookSite>> hookSites;
+    std::vector<Utils::PatchTransaction> appliedPatches;
+    std::vector<std::pair<void*, Utils::InstructionIndex>> instructionIndexes;
+    std::vector<std::pair<void*, std::unique_ptr<ModuleMap>>> moduleMaps;
+    std::mutex moduleMapsMutex;
+}
+
+namespace
+{
+    /**
+     * @brief Returns the map of a loaded module, parsing its PE headers on first use.
+     * @details A map is parsed again if another build was loaded at the same address
+     *      in the meantime. The caller has to hold `moduleMapsMutex`.
+     *
+     * @param module Base address of the module.
+     * @return ModuleMap* of the module, nullptr if its headers are malformed.
+     */
+    ModuleMap* moduleMap(void* module)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((u8*)module + dosHeader->e_lfanew);
+        auto timeDateStamp = ntHeaders->FileHeader.TimeDateStamp;
+
+        auto it = std::find_if(moduleMaps.begin(), moduleMaps.end(), [module](const auto& entry) {
+            return entry.first == module;
+        });
+        if (it != moduleMaps.end() && it->second->timeDateStamp == timeDateStamp) {
+            return it->second.get();
+        }
+
+        auto sizeOfHeaders = ntHeaders->OptionalHeader.SizeOfHeaders;
+        auto info = Utils::parsePe(std::span<const u8>(reinterpret_cast<const u8*>(module), sizeOfHeaders));
+        if (!info) {
+            return nullptr;
+        }
+        auto map = std::make_unique<ModuleMap>(ModuleMap{ timeDateStamp, std::move(*info), std::nullopt, {}, {} });
+        if (it != moduleMaps.end()) {
+            it->second = std::move(map);
+            return it->second.get();
+        }
+        moduleMaps.emplace_back(module, std::move(map));
+        return moduleMaps.back().second.get();
+    }
+
+    /**
+     * @brief Returns the parsed PE headers of a loaded module.
+     *
+     * @param module Base address of the module.
+     * @return std::optional<Utils::PeInfo> containing the parsed headers.
+     */
+    std::optional<Utils::PeInfo> moduleHeaders(void* module)
+    {
+        std::lock_guard lock(moduleMapsMutex);
+        const ModuleMap* map = moduleMap(module);
+        return map ? std::optional(map->info) : std::nullopt;
+    }
+
+    /**
+     * @brief Returns the function index of a loaded module, built from its .pdata table
+     *      on first use.
+     *
+     * @param module Base address of the module.
+     * @return const Utils::FunctionIndex& of the module, empty if it has no exception
+     *      directory.
+     */
+    const Utils::FunctionIndex& moduleFunctions(void* module)
+    {
+        static const Utils::FunctionIndex none;
+
+        std::lock_guard lock(moduleMapsMutex);
+        ModuleMap* map = moduleMap(module);
+        if (map == nullptr) {
+            return none;
+        }
+        if (!map->functions) {
+            const auto& directory = map->info.directories[Utils::DIRECTORY_EXCEPTION];
+            if (directory.rva == 0 || directory.size == 0 || directory.rva + directory.size > map->info.sizeOfImage) {
+                map->functions.emplace();
+            }
+            else {
+                map->functions.emplace(std::span<const u8>(reinterpret_cast<const u8*>(module) + directory.rva, directory.size));
+            }
+        }
+        return *map->functions;
+    }
+
+    /**
+     * @brief Returns the byte-frequency table of a module section, sampled on first use.
+     * @details Sampling reads a sixteenth of the section, doing it once per module keeps
+     *      that cost out of every later scan.
+     *
+     * @param module Base address of the module.
+     * @param section Section name, empty for all executable sections.
+     * @return Utils::ByteFrequency of the section.
+     */
+    Utils::ByteFrequency moduleFrequency(void* module, const std::string& section)
+    {
+        {
+            std::lock_guard lock(moduleMapsMutex);
+            ModuleMap* map = moduleMap(module);
+            if (map == nullptr) {
+                return Utils::sampleFrequency({});
+            }
+            for (const auto& [name, frequency] : map->frequencies) {
+                if (name == section) {
+                    return frequency;
+                }
+            }
+        }
+
+        // Sampled without the lock, sections of other modules are scanned meanwhile.
+        auto frequency = Utils::sampleFrequency(Utils::scanRegions(module, section));
+        std::lock_guard lock(moduleMapsMutex);
+        ModuleMap* map = moduleMap(module);
+        if (map != nullptr) {
+            auto it = std::find_if(map->frequencies.begin(), map->frequencies.end(), [&](const auto& entry) {
+                return entry.first == section;
+            });
+            if (it == map->frequencies.end()) {
+                map->frequencies.emplace_back(section, frequency);
+            }
+        }
+        return frequency;
+    }
+
+    /**
+     * @brief Checks whether a hit is inside the scope of its signature.
+     * @details Gaps make a match longer than the pattern, so a gapped pattern is
+     *      matched again within the bytes left in the function. A gap that reaches past
+     *      the end of the function does not count.
+     *
+     * @param functions Function index of the module.
+     * @param base Base address of the module.
+     * @param rva RVA of the hit.
+     * @param lookup Signature that was hit.
+     * @return true if the hit is accepted.
+     */
+    bool inScope(const Utils::FunctionIndex& functions, const u8* base, u32 rva, const Lookup& lookup)
+    {
+        u32 size = static_cast<u32>(lookup.pattern.size());
+        if (lookup.scope == Utils::Scope::Anywhere) {
+            return true;
+        }
+        if (!functions.contains(rva, size)) {
+            return false;
+        }
+        const Utils::Function* function = functions.find(rva);
+        if (lookup.scope == Utils::Scope::FunctionStart && function->begin != rva) {
+            return false;
+        }
+        return lookup.pattern.gaps.empty() || Utils::matches(std::span<const u8>(base + rva, function->end - rva), lookup.pattern);
+    }
+
+    /**
+     * @brief Returns the instruction index of a module, decoding it on first use.
+     *
+     * @param module Base address of the module.
+     * @return const Utils::InstructionIndex& of the module.
+     */
+    const Utils::InstructionIndex& moduleInstructions(void* module)
+    {
+        for (const auto& [indexed, index] : instructionIndexes) {
+            if (indexed == module) {
+                return index;
+            }
+        }
+
+        auto base = reinterpret_cast<const u8*>(module);
+        const auto& functions = moduleFunctions(module);
+        if (!functions.empty()) {
+            instructionIndexes.emplace_back(module, Utils::InstructionIndex(base, functions.functions()));
+        }
+        else {
+            auto regions = Utils::scanRegions(module);
+            instructionIndexes.emplace_back(module, Utils::InstructionIndex(base, regions));
+        }
+        return instructionIndexes.back().second;
+    }
+
+    /**
+     * @brief Narrows memory regions down to the code covered by the function index.
+     * @details Functions closer together than `MERGE_GAP` are kept as one region, so
+     *      the scanner is not handed thousands of tiny regions for nothing but the
+     *      alignment padding between them. Larger gaps, such as data islands, are
+     *      dropped.
+     *
+     * @param regions Readable regions of the module, ordered by address.
+     * @param functions Function index of the module.
+     * @param base Base address of the module.
+     * @return std::vector<std::span<const u8>> containing the narrowed regions.
+     */
+    std::vector<std::span<const u8>> functionRegions(const std::vector<std::span<const u8>>& regions, const Utils::FunctionIndex& functions, const u8* base)
+    {
+        constexpr u32 MERGE_GAP = 64;
+
+        std::vector<std::span<const u8>> narrowed;
+        for (const auto& region : regions) {
+            u32 regionBegin = static_cast<u32>(region.data() - base);
+            u32 regionEnd = static_cast<u32>(regionBegin + region.size());
+            u32 begin = 0;
+            u32 end = 0;
+            for (const auto& function : functions.functions()) {
+                u32 first = std::max(function.begin, regionBegin);
+                u32 last = std::min(function.end, regionEnd);
+                if (first >= last) {
+                    continue;
+                }
+                if (end != 0 && first <= end + MERGE_GAP) {
+                    end = std::max(end, last);
+                    continue;
+                }
+                if (end != 0) {
+                    narrowed.emplace_back(base + begin, end - begin);
+                }
+                begin = first;
+                end = last;
+            }
+            if (end != 0) {
+                narrowed.emplace_back(base + begin, end - begin);
+            }
+        }
+        return narrowed;
+    }
+
+    /**
+     * @brief Builds the cache key of a module, the signature hash is filled in per lookup.
+     *
+     * @param module Base address of the module.
+     * @return std::optional<Utils::CacheKey> of the current build, empty if the headers
+     *      are malformed.
+     */
+    std::optional<Utils::CacheKey> moduleKey(HMODULE module)
+    {
+        auto info = moduleHeaders(module);
+        if (!info) {
+            return std::nullopt;
+        }
+        return Utils::CacheKey{
+            .timeDateStamp = info->timeDateStamp,
+            .checkSum = info->checkSum,
+            .sizeOfImage = info->sizeOfImage
+        };
+    }
+
+    /**
+     * @brief Returns the function index of a module if any lookup needs it.
+     */
+    const Utils::FunctionIndex& scopeFunctions(HMODULE module, const std::vector<Lookup>& lookups)
+    {
+        static const Utils::FunctionIndex unscoped;
+        bool anyScoped = std::any_of(lookups.begin(), lookups.end(), [](const Lookup& lookup) {
+            return lookup.scope != Utils::Scope::Anywhere;
+        });
+        return anyScoped ? moduleFunctions(module) : unscoped;
+    }
+
+    /**
+     * @brief Returns the sections that still have to be scanned for a module.
+     *
+     * @param lookups Lookups of the module after `verifyCached`.
+     * @return std::vector<std::string> containing every distinct section once.
+     */
+    std::vector<std::string> pendingSections(const std::vector<Lookup>& lookups)
+    {
+        std::vector<std::string> sections;
+        for (const auto& lookup : lookups) {
+            if (!lookup.cached && !lookup.skipped) {
+                sections.push_back(lookup.section);
+            }
+        }
+        std::sort(sections.begin(), sections.end());
+        sections.erase(std::unique(sections.begin(), sections.end()), sections.end());
+        return sections;
+    }
+
+    /**
+     * @brief Resolves the signatures of a module that have a cache entry for its build.
+     * @details Every cached RVA is verified to still match, stale entries are erased.
+     *      Once an alternative of a group was verified the alternatives after it are
+     *      skipped, the higher priority ones before it are still scanned for by
+     *      `scanSection` and win if they are found, e.g. after the primary signature
+     *      was corrected.
+     *
+     * @param module Base address of the module to search.
+     * @param lookups Signatures to resolve, `address`, `count`, `cached` and `skipped`
+     *      are filled in.
+     * @param cache Cache of previously resolved RVAs.
+     */
+    void verifyCached(HMODULE module, std::vector<Lookup>& lookups, SharedCache& cache)
+    {
+        auto base = reinterpret_cast<const u8*>(module);
+        auto key = moduleKey(module);
+        if (!key) {
+            return;
+        }
+        const auto& functions = scopeFunctions(module, lookups);
+
+        for (auto& lookup : lookups) {
+            key->signatureHash = Utils::hashSignature(lookup.text, lookup.section, lookup.match, static_cast<u32>(lookup.scope), lookup.unique);
+            auto rva = cache.find(*key);
+            if (!rva) {
+                continue;
+            }
+            const u8* candidate = base + *rva;
+            for (const auto& region : Utils::scanRegions(module, lookup.section)) {
+                if (candidate >= region.data() && candidate < region.data() + region.size() &&
+                    Utils::matches(region.subspan(candidate - region.data()), lookup.pattern) &&
+                    inScope(functions, base, *rva, lookup)) {
+                    lookup.address = reinterpret_cast<u64>(candidate);
+                    lookup.count = 1;
+                    lookup.cached = true;
+                    break;
+                }
+            }
+            if (!lookup.cached) {
+                cache.erase(*key);
+            }
+        }
+
+        // A verified alternative beats the alternatives after it in its group.
+        std::vector<size_t> settled;
+        for (auto& lookup : lookups) {
+            if (std::binary_search(settled.begin(), settled.end(), lookup.group)) {
+                lookup.skipped = !lookup.cached;
+            }
+            else if (lookup.cached) {
+                settled.insert(std::upper_bound(settled.begin(), settled.end(), lookup.group), lookup.group);
+            }
+        }
+    }
+
+    /**
+     * @brief Scans one section of a module for the signatures not resolved by `verifyCached`.
+     * @details All signatures of the section share one chunked scan, the results are
+     *      written back to the cache. Since the selected hit depends on all other hits,
+     *      ambiguous signatures are only cached once they were accepted.
+     *      Only the lookups of `section` are touched, so different sections of the same
+     *      module can be scanned concurrently.
+     *
+     * @param module Base address of the module to search.
+     * @param lookups Signatures of the module, `address` and `count` are filled in.
+     * @param section Section to scan.
+     * @param cache Cache of previously resolved RVAs.
+     * @param threads Maximum number of threads scanning the section.
+     */
+    void scanSection(HMODULE module, std::vector<Lookup>& lookups, const std::string& section, SharedCache& cache, u32 threads)
+    {
+        auto base = reinterpret_cast<const u8*>(module);
+        auto key = moduleKey(module);
+        if (!key) {
+            return;
+        }
+        const auto& functions = scopeFunctions(module, lookups);
+        auto regions = Utils::scanRegions(module, section);
+
+        std::vector<Lookup*> pending;
+        for (auto& lookup : lookups) {
+            if (lookup.section == section && !lookup.cached && !lookup.skipped) {
+                pending.push_back(&lookup);
+            }
+        }
+        if (pending.empty()) {
+            return;
+        }
+
+        // Function start signatures are compared at every function start, the
+        // rest share one scan of the section.
+        std::vector<std::vector<const u8*>> hits(pending.size());
+        Utils::MultiScanner scanner(moduleFrequency(module, section), threads);
+        std::vector<size_t> scanned;
+        std::vector<size_t> limits;
+        bool scoped = !functions.empty();
+        for (size_t i = 0; i < pending.size(); i++) {
+            scoped &= (pending[i]->scope != Utils::Scope::Anywhere);
+            if (pending[i]->scope != Utils::Scope::FunctionStart) {
+                // One hit past the requested match tells whether it is ambiguous,
+                // scoped signatures need every hit as some are dropped below.
+                scanner.add(pending[i]->pattern);
+                scanned.push_back(i);
+                limits.push_back(pending[i]->scope == Utils::Scope::Anywhere ? pending[i]->match + 2 : SIZE_MAX);
+                continue;
+            }
+            for (const auto& function : functions.functions()) {
+                const u8* candidate = base + function.begin;
+                for (const auto& region : regions) {
+                    if (candidate >= region.data() && candidate < region.data() + region.size()) {
+                        if (Utils::matches(region.subspan(candidate - region.data()), pending[i]->pattern)) {
+                            hits[i].push_back(candidate);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+        if (!scanned.empty()) {
+            auto found = scanner.scanAll(scoped ? functionRegions(regions, functions, base) : regions, limits);
+            for (size_t j = 0; j < scanned.size(); j++) {
+                hits[scanned[j]] = std::move(found[j]);
+            }
+        }
+
+        for (size_t i = 0; i < pending.size(); i++) {
+            Lookup& lookup = *pending[i];
+            std::erase_if(hits[i], [&](const u8* hit) {
+                return !inScope(functions, base, static_cast<u32>(hit - base), lookup);
+            });
+            lookup.count = hits[i].size();
+            if (lookup.match >= lookup.count || (lookup.unique && lookup.count > 1)) {
+                continue;
+            }
+            const u8* hit = hits[i][lookup.match];
+            lookup.address = reinterpret_cast<u64>(hit);
+            key->signatureHash = Utils::hashSignature(lookup.text, lookup.section, lookup.match, static_cast<u32>(lookup.scope), lookup.unique);
+            cache.store(*key, static_cast<u32>(hit - base));
+        }
+    }
+}
+
+namespace
+{
+    /**
+     * @brief Logs why a lookup was not resolved, or that it was ambiguous.
+     *
+     * @param lookup Resolved lookup.
+     * @return true if the lookup has an address to use.
+     */
+    bool located(const Lookup& lookup)
+    {
+        if (lookup.skipped) {
+            return false;
+        }
+        if (lookup.count == 0) {
+            LOG("Did not find '{}'", lookup.text);
+        }
+        else if (lookup.unique && lookup.count > 1) {
+            LOG("'{}' is ambiguous, at least {} matches", lookup.text, lookup.count);
+        }
+        else if (lookup.match >= lookup.count) {
+            LOG("'{}' has {} matches, match {} requested", lookup.text, lookup.count, lookup.match);
+        }
+        else if (lookup.count > 1) {
+            LOG("'{}' has at least {} matches, using match {}", lookup.text, lookup.count, lookup.match);
+        }
+        return lookup.address != 0;
+    }
+
+    /**
+     * @brief Describes where the address of a lookup came from, for logging.
+     *
+     * @param lookup Resolved lookup.
+     * @return const char* containing the suffix, empty for scanned lookups.
+     */
+    const char* suffix(const Lookup& lookup)
+    {
+        return lookup.cached ? " (cached)" : "";
+    }
+
+    /**
+     * @brief Picks the alternative of a hook or patch to use.
+     *
+     * @param lookups All lookups of the module.
+     * @param first Index of the primary signature, its fallbacks follow in order.
+     * @param count Number of alternatives.
+     * @return const Lookup* of the highest priority alternative found, else nullptr.
+     */
+    const Lookup* select(const std::vector<Lookup>& lookups, size_t first, size_t count)
+    {
+        for (size_t i = first; i < first + count; i++) {
+            if (located(lookups[i])) {
+                return &lookups[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Picks the module and alternative of a hook or patch to use.
+     * @details A hook or patch placed in several modules uses the first module in
+     *      which one of its alternatives was accepted, misses in the other modules are
+     *      not logged. Hits rejected for being ambiguous or for lacking the requested
+     *      match do not stop the search, they are only logged if no module is usable.
+     *
+     * @param targets Resolved modules.
+     * @param placement Where the alternatives were placed, in the order modules are tried.
+     * @param count Number of alternatives.
+     * @return std::pair<const Target*, const Lookup*> of the alternative to use, both
+     *      nullptr if none was found.
+     */
+    std::pair<const Target*, const Lookup*> choose(const std::vector<Target>& targets, const Placement& placement, size_t count)
+    {
+        auto alternatives = [&](size_t index, size_t first) {
+            const auto& lookups = targets[index].lookups;
+            return std::span<const Lookup>(lookups.data() + first, count);
+        };
+        for (auto [index, first] : placement) {
+            auto candidates = alternatives(index, first);
+            bool usable = placement.size() == 1 || std::any_of(candidates.begin(), candidates.end(), [](const Lookup& lookup) {
+                return !lookup.skipped && lookup.address != 0;
+            });
+            if (usable) {
+                return { &targets[index], select(targets[index].lookups, first, count) };
+            }
+        }
+        for (auto [index, first] : placement) {
+            auto candidates = alternatives(index, first);
+            bool hit = std::any_of(candidates.begin(), candidates.end(), [](const Lookup& lookup) {
+                return !lookup.skipped && lookup.count != 0;
+            });
+            if (hit) {
+                LOG("Rejected the hits of '{}' in {:s}", candidates[0].text, targets[index].name);
+                select(targets[index].lookups, first, count);
+            }
+        }
+        if (!placement.empty()) {
+            LOG("Did not find '{}' in any module", targets[placement[0].first].lookups[placement[0].second].text);
+        }
+        return { nullptr, nullptr };
+    }
+}
 
 namespace Utils
 {
@@ -78,99 +705,477 @@ namespace Utils
         return {};
     }
 
-    void patch(u64 address, std::string& pattern)
+    void patch(u64 address, Utils::PatternView pattern)
     {
-        static auto patternToByte = [](std::string& pattern) {
-            std::vector<u8> bytes;
-            std::istringstream stream(pattern.data());
-            std::string byteStr;
+        Utils::PatchTransaction transaction;
+        if (!transaction.add(address, pattern)) {
+            LOG("Patch at {:#x} contains gaps or byte sets, skipped", address);
+            return;
+        }
+        transaction.commit();
+    }
 
-            while (stream >> byteStr) {  // Extract space-separated hex values
-                bytes.push_back(static_cast<u8>(std::stoul(byteStr, nullptr, 16)));
+    std::vector<std::span<const u8>> scanRegions(void* module, const std::string& section)
+    {
+        auto base = reinterpret_cast<const u8*>(module);
+        std::lock_guard lock(moduleMapsMutex);
+        ModuleMap* map = moduleMap(module);
+        if (map == nullptr) {
+            return {};
+        }
+        for (const auto& [name, regions] : map->regions) {
+            if (name == section) {
+                return regions;
+            }
+        }
+        const Utils::PeInfo* info = &map->info;
+
+        std::vector<std::span<const u8>> regions;
+        for (const auto& sec : info->sections) {
+            bool selected = section.empty() ? sec.executable() : (sec.name == section);
+            if (!selected || sec.size == 0) {
+                continue;
             }
-            return bytes;
-        };
 
-        DWORD oldProtect;
-        auto patternBytes = patternToByte(pattern);
-        VirtualProtect((LPVOID)address, patternBytes.size(), PAGE_EXECUTE_READWRITE, &oldProtect);
-        memcpy((LPVOID)address, patternBytes.data(), patternBytes.size());
-        VirtualProtect((LPVOID)address, patternBytes.size(), oldProtect, &oldProtect);
+            // Only keep committed pages that can be read without faulting.
+            const u8* current = base + sec.rva;
+            const u8* end = base + sec.rva + sec.size;
+            while (current < end) {
+                MEMORY_BASIC_INFORMATION mbi{};
+                if (VirtualQuery(current, &mbi, sizeof(mbi)) == 0) {
+                    break;
+                }
+                const u8* regionEnd = std::min(end, reinterpret_cast<const u8*>(mbi.BaseAddress) + mbi.RegionSize);
+                bool readable = (mbi.State == MEM_COMMIT) &&
+                    !(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD)) &&
+                    (mbi.Protect & (PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+                                    PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY));
+                if (readable) {
+                    if (!regions.empty() && regions.back().data() + regions.back().size() == current) {
+                        regions.back() = std::span<const u8>(regions.back().data(), regionEnd - regions.back().data());
+                    }
+                    else {
+                        regions.emplace_back(current, regionEnd - current);
+                    }
+                }
+                current = regionEnd;
+            }
+        }
+        map->regions.emplace_back(section, regions);
+        return regions;
     }
 
-    u64 patternScan(void* module, std::string& signature)
+    u64 patternScan(void* module, Utils::PatternView signature, const std::string& section)
     {
-        static auto pattern_to_byte = [](const char* pattern) {
-            struct Pattern {
-                std::vector<u8> bytes;
-                std::vector<u8> check;
-            };
-            auto start = const_cast<char*>(pattern);
-            auto end = const_cast<char*>(pattern) + strlen(pattern);
+        auto prepared = Utils::prepare(signature, moduleFrequency(module, section));
+        for (const auto& region : Utils::scanRegions(module, section)) {
+            auto hit = Utils::scanParallel(region, prepared);
+            if (hit != nullptr) {
+                return reinterpret_cast<u64>(hit);
+            }
+        }
+        return 0;
+    }
 
-            Pattern pat = {};
-            for (auto current = start; current < end; ++current) {
-                if (*current == ' ') {
-                    continue;
+    std::vector<u64> patternScanAll(void* module, Utils::PatternView signature, const std::string& section)
+    {
+        Utils::MultiScanner scanner(moduleFrequency(module, section));
+        scanner.add(signature);
+
+        std::vector<u64> addresses;
+        for (const u8* hit : scanner.scanAll(Utils::scanRegions(module, section))[0]) {
+            addresses.push_back(reinterpret_cast<u64>(hit));
+        }
+        return addresses;
+    }
+
+    std::vector<u64> instructionScan(void* module, const Utils::InstructionPattern& pattern)
+    {
+        std::vector<u64> addresses;
+        for (u32 rva : moduleInstructions(module).find(pattern)) {
+            addresses.push_back(reinterpret_cast<u64>(module) + rva);
+        }
+        return addresses;
+    }
+
+    std::vector<u64> referencesTo(void* module, u64 address)
+    {
+        u64 base = reinterpret_cast<u64>(module);
+        std::vector<u64> addresses;
+        if (address < base || address - base > UINT32_MAX) {
+            return addresses;
+        }
+        for (const auto& reference : moduleInstructions(module).referencesTo(static_cast<u32>(address - base))) {
+            addresses.push_back(base + reference.rva);
+        }
+        return addresses;
+    }
+
+    std::vector<u64> constantUses(void* module, u32 value)
+    {
+        std::vector<u64> addresses;
+        for (const auto& reference : moduleInstructions(module).constantUses(value)) {
+            addresses.push_back(reinterpret_cast<u64>(module) + reference.rva);
+        }
+        return addresses;
+    }
+
+    std::vector<u64> patternScan(void* module, std::span<const Utils::PatternView> signatures, const std::string& section)
+    {
+        Utils::MultiScanner scanner(moduleFrequency(module, section));
+        for (const auto& signature : signatures) {
+            scanner.add(signature);
+        }
+
+        std::vector<u64> addresses;
+        for (const u8* hit : scanner.scan(Utils::scanRegions(module, section))) {
+            addresses.push_back(reinterpret_cast<u64>(hit));
+        }
+        return addresses;
+    }
+
+    void revertPatches()
+    {
+        // Undo in reverse, later transactions may have patched over earlier ones.
+        for (auto it = appliedPatches.rbegin(); it != appliedPatches.rend(); it++) {
+            it->rollback();
+        }
+        appliedPatches.clear();
+    }
+
+    Utils::HookSite* findHookSite(u64 address)
+    {
+        for (auto& site : hookSites) {
+            if (site->address() == address) {
+                return site.get();
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<Utils::ModuleInfo> enumerateModules()
+    {
+        HANDLE process = GetCurrentProcess();
+        std::vector<HMODULE> handles(256);
+        DWORD needed = 0;
+        while (true) {
+            DWORD size = static_cast<DWORD>(handles.size() * sizeof(HMODULE));
+            if (!EnumProcessModules(process, handles.data(), size, &needed)) {
+                return {};
+            }
+            if (needed <= size) {
+                break;
+            }
+            handles.resize(needed / sizeof(HMODULE));
+        }
+        handles.resize(needed / sizeof(HMODULE));
+
+        std::vector<Utils::ModuleInfo> modules;
+        for (HMODULE handle : handles) {
+            char name[MAX_PATH] = {};
+            GetModuleBaseNameA(process, handle, name, MAX_PATH);
+            modules.emplace_back(handle, name);
+        }
+        return modules;
+    }
+
+    void queueHook(Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::HookCallback& callback)
+    {
+        pendingHooks.push_back({ &module, hook, callback });
+    }
+
+    void queueCave(Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::CaveCode& code)
+    {
+        pendingCaves.push_back({ &module, hook, code });
+    }
+
+    void injectCave(bool enable, Utils::ModuleInfo& module, Utils::SignatureHook& hook, const Utils::CaveCode& code)
+    {
+        LOG("Fix {}", enable ? "Enabled" : "Disabled");
+        if (enable) {
+            Utils::queueCave(module, hook, code);
+        }
+    }
+
+    void injectPatch(bool enable, Utils::ModuleInfo& module, Utils::SignaturePatch& sp)
+    {
+        LOG("Fix {}", enable ? "Enabled" : "Disabled");
+        if (enable) {
+            pendingPatches.push_back({ &module, sp });
+        }
+    }
+
+    void applyInjections(const std::string& cachePath)
+    {
+        Utils::SignatureCache cache;
+        if (!cachePath.empty()) {
+            cache.load(cachePath);
+        }
+        SharedCache shared(cachePath.empty() ? nullptr : &cache);
+
+        // Loaded modules are only enumerated if a hook or patch names its module.
+        bool named = std::any_of(pendingPatches.begin(), pendingPatches.end(), [](const PendingPatch& pending) {
+            return !pending.sp.module.empty();
+        }) || std::any_of(pendingHooks.begin(), pendingHooks.end(), [](const PendingHook& pending) {
+            return !pending.hook.module.empty();
+        }) || std::any_of(pendingCaves.begin(), pendingCaves.end(), [](const PendingCave& pending) {
+            return !pending.hook.module.empty();
+        });
+        auto loaded = named ? Utils::enumerateModules() : std::vector<Utils::ModuleInfo>();
+
+        std::vector<Target> targets;
+        auto target = [&](HMODULE address, const std::string& name) {
+            for (size_t i = 0; i < targets.size(); i++) {
+                if (targets[i].address == address) {
+                    return i;
                 }
-                else if (*current == '?') {
-                    current += 2;
-                    pat.bytes.push_back(0xFF);
-                    pat.check.push_back(0);
+            }
+            targets.push_back({ address, name, {}, 0 });
+            return targets.size() - 1;
+        };
+
+        // Every hook or patch takes one lookup per alternative in each module it is
+        // searched in, modules are tried in load order.
+        auto place = [&](Utils::ModuleInfo* module, const std::string& name, std::vector<Lookup> alternatives) {
+            std::vector<size_t> indices;
+            if (name.empty()) {
+                indices.push_back(target(module->address, module->name));
+            }
+            for (const auto& candidate : loaded) {
+                if (!name.empty() && (name == Utils::ANY_MODULE || _stricmp(candidate.name.c_str(), name.c_str()) == 0)) {
+                    indices.push_back(target(candidate.address, candidate.name));
                 }
-                else {
-                    pat.bytes.push_back(strtoul(current, &current, 16));
-                    pat.check.push_back(1);
+            }
+            if (indices.empty()) {
+                LOG("Module '{:s}' is not loaded", name);
+            }
+
+            Placement placement;
+            for (size_t index : indices) {
+                auto& destination = targets[index];
+                placement.emplace_back(index, destination.lookups.size());
+                for (auto& alternative : alternatives) {
+                    alternative.group = destination.groups;
+                    destination.lookups.push_back(alternative);
                 }
+                destination.groups++;
             }
-            return pat;
+            return placement;
         };
 
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((u8*)module + dosHeader->e_lfanew);
+        std::vector<std::pair<PendingPatch*, Placement>> patches;
+        for (auto& pending : pendingPatches) {
+            const auto& sp = pending.sp;
+            std::vector<Lookup> alternatives;
+            alternatives.push_back({
+                sp.signature.view(), sp.signature.str(), sp.section,
+                sp.match, sp.unique, sp.scope, sp.patchOffset
+            });
+            for (const auto& fallback : sp.fallbacks) {
+                alternatives.push_back({
+                    fallback.signature.view(), fallback.signature.str(), sp.section,
+                    fallback.match, sp.unique, sp.scope, fallback.patchOffset
+                });
+            }
+            patches.emplace_back(&pending, place(pending.module, sp.module, std::move(alternatives)));
+        }
+
+        auto hookAlternatives = [](const Utils::SignatureHook& hook) {
+            std::vector<Lookup> alternatives;
+            alternatives.push_back({
+                hook.signature.view(), hook.signature.str(), hook.section,
+                hook.match, hook.unique, hook.scope, hook.offset
+            });
+            for (const auto& fallback : hook.fallbacks) {
+                alternatives.push_back({
+                    fallback.signature.view(), fallback.signature.str(), hook.section,
+                    fallback.match, hook.unique, hook.scope, fallback.offset
+                });
+            }
+            return alternatives;
+        };
 
-        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
-        auto pattern = pattern_to_byte(signature.c_str());
-        auto scanBytes = reinterpret_cast<u8*>(module);
+        std::vector<std::pair<PendingHook*, Placement>> hooks;
+        for (auto& pending : pendingHooks) {
+            hooks.emplace_back(&pending, place(pending.module, pending.hook.module, hookAlternatives(pending.hook)));
+        }
 
-        auto size = pattern.bytes.size();
-        auto data = pattern.bytes.data();
-        auto check = pattern.check.data();
+        std::vector<std::pair<PendingCave*, Placement>> caves;
+        for (auto& pending : pendingCaves) {
+            caves.emplace_back(&pending, place(pending.module, pending.hook.module, hookAlternatives(pending.hook)));
+        }
 
-        for (auto i = 0ul; i < (sizeOfImage - size); i++) {
-            bool found = true;
-            for (auto j = 0ul; j < size; j++) {
-                u8 byte = data[j];
-                if ((check[j] == 1) && (scanBytes[i + j] != byte)) {
-                    found = false;
-                    break;
+        // Cached RVAs are cheap to verify, every (module, section) pair that still has to
+        // be scanned becomes a job for a pool bounded by the hardware threads. Large
+        // sections go first so they do not end up as the last job running.
+        std::vector<std::tuple<size_t, std::string, size_t>> jobs;
+        for (size_t i = 0; i < targets.size(); i++) {
+            verifyCached(targets[i].address, targets[i].lookups, shared);
+            for (auto& section : pendingSections(targets[i].lookups)) {
+                size_t bytes = 0;
+                for (const auto& region : Utils::scanRegions(targets[i].address, section)) {
+                    bytes += region.size();
                 }
+                jobs.emplace_back(i, std::move(section), bytes);
             }
-            if (found) {
-                return reinterpret_cast<u64>(&scanBytes[i]);
+        }
+        std::sort(jobs.begin(), jobs.end(), [](const auto& a, const auto& b) {
+            return std::get<2>(a) > std::get<2>(b);
+        });
+
+        u32 hardware = std::max(1u, std::thread::hardware_concurrency());
+        size_t poolSize = std::min<size_t>(hardware, jobs.size());
+        u32 threads = std::max<u32>(1, hardware / static_cast<u32>(std::max<size_t>(1, poolSize)));
+        std::atomic<size_t> nextJob = 0;
+        auto work = [&]() {
+            size_t index;
+            while ((index = nextJob.fetch_add(1)) < jobs.size()) {
+                const auto& [target, section, bytes] = jobs[index];
+                scanSection(targets[target].address, targets[target].lookups, section, shared, threads);
             }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < poolSize; i++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
         }
-        return 0;
-    }
 
-    void injectPatch(bool enable, Utils::ModuleInfo& module, Utils::SignaturePatch& sp)
-    {
-        LOG("Fix {}", enable ? "Enabled" : "Disabled");
-        if (enable) {
-            u64 addr = Utils::patternScan(module.address, sp.signature);
-            if (addr != 0) {
-                u64 hit = addr;
-                u64 absAddr = hit;
-                u64 relAddr = hit - reinterpret_cast<u64>(module.address);
-                LOG("Found '{}' @ {:s}+{:x}", sp.signature, module.name, relAddr);
-                u64 patchAbsAddr = absAddr + sp.patchOffset;
-                u64 patchRelAddr = relAddr + sp.patchOffset;
-                Utils::patch(patchAbsAddr, sp.patch);
-                LOG("Patched '{}' @ {:s}+{:x}", sp.patch, module.name, patchRelAddr);
+        // Patches, code caves and hooks are staged first and written together.
+        Utils::PatchTransaction transaction;
+        std::vector<std::tuple<const Utils::SignaturePatch*, std::string, u64>> written;
+        for (auto& [pending, placement] : patches) {
+            auto& sp = pending->sp;
+            auto [module, lookup] = choose(targets, placement, 1 + sp.fallbacks.size());
+            if (lookup != nullptr) {
+                u64 base = reinterpret_cast<u64>(module->address);
+                u64 absAddr = lookup->address;
+                u64 relAddr = lookup->address - base;
+                LOG("Found '{}' @ {:s}+{:x}{:s}", lookup->text, module->name, relAddr, suffix(*lookup));
+                u64 patchAbsAddr = absAddr + lookup->offset;
+                u64 patchRelAddr = relAddr + lookup->offset;
+                auto location = std::format("{:s}+{:x}", module->name, patchRelAddr);
+                if (transaction.add(patchAbsAddr, sp.patch.view(), std::format("patch '{}' @ {:s}", sp.patch.str(), location))) {
+                    written.emplace_back(&sp, std::move(location), patchAbsAddr);
+                }
+                else {
+                    LOG("Patch '{}' contains gaps or byte sets, skipped", sp.patch.str());
+                }
+            }
+        }
+        // Code caves are built right away, only the jumps to them go into the transaction.
+        std::vector<std::tuple<std::string, u64, Utils::Cave>> diverted;
+        auto divert = [&](u64 address, const std::string& location, const Utils::CaveCode& code) {
+            auto cave = Utils::Cave::build(address, code);
+            if (!cave || !transaction.add(address, cave->jump, std::format("hook @ {:s}", location))) {
+                LOG("Failed to build a code cave @ {:s}", location);
+                if (cave) {
+                    Utils::Cave::release(*cave);
+                }
+                return false;
+            }
+            for (auto [from, to] : cave->redirects) {
+                transaction.redirect(from, to);
+            }
+            transaction.flush(cave->address, cave->size);
+            diverted.emplace_back(location, address, std::move(*cave));
+            return true;
+        };
+
+        for (auto& [pending, placement] : caves) {
+            auto& hook = pending->hook;
+            auto [module, lookup] = choose(targets, placement, 1 + hook.fallbacks.size());
+            if (lookup != nullptr) {
+                u64 base = reinterpret_cast<u64>(module->address);
+                u64 absAddr = lookup->address;
+                u64 relAddr = lookup->address - base;
+                LOG("Found '{}' @ {:s}+{:x}{:s}", lookup->text, module->name, relAddr, suffix(*lookup));
+                u64 caveAbsAddr = absAddr + lookup->offset;
+                u64 caveRelAddr = relAddr + lookup->offset;
+                divert(caveAbsAddr, std::format("{:s}+{:x}", module->name, caveRelAddr), pending->code);
+            }
+        }
+
+        // Hooks on the same address are gathered into one site, in the order they were queued.
+        struct StagedSite {
+            u64 address;
+            std::string location;
+            std::vector<Utils::HookCallback> callbacks;
+        };
+        std::vector<StagedSite> staged;
+        for (auto& [pending, placement] : hooks) {
+            auto& hook = pending->hook;
+            auto [module, lookup] = choose(targets, placement, 1 + hook.fallbacks.size());
+            if (lookup != nullptr) {
+                u64 base = reinterpret_cast<u64>(module->address);
+                u64 absAddr = lookup->address;
+                u64 relAddr = lookup->address - base;
+                LOG("Found '{}' @ {:s}+{:x}{:s}", lookup->text, module->name, relAddr, suffix(*lookup));
+                u64 hookAbsAddr = absAddr + lookup->offset;
+                u64 hookRelAddr = relAddr + lookup->offset;
+                auto site = std::find_if(staged.begin(), staged.end(), [&](const StagedSite& candidate) {
+                    return candidate.address == hookAbsAddr;
+                });
+                if (site == staged.end()) {
+                    staged.push_back({ hookAbsAddr, std::format("{:s}+{:x}", module->name, hookRelAddr), {} });
+                    site = staged.end() - 1;
+                }
+                site->callbacks.push_back(pending->callback);
+            }
+        }
+
+        std::vector<std::unique_ptr<Utils::HookSite>> sites;
+        for (auto& [address, location, callbacks] : staged) {
+            if (auto* existing = Utils::findHookSite(address)) {
+                bool added = existing->update([&](auto& combined) {
+                    combined.insert(combined.end(), callbacks.begin(), callbacks.end());
+                });
+                if (added) {
+                    LOG("Hooked @ {:s}, added to the existing hook", location);
+                }
+                else {
+                    LOG("Hook @ {:s} needs registers the existing hook does not save", location);
+                }
+                continue;
+            }
+            auto site = std::make_unique<Utils::HookSite>(address, std::move(callbacks));
+            if (divert(address, location, site->code())) {
+                sites.push_back(std::move(site));
+            }
+        }
+
+        // Patches the transaction dropped are logged by it, their caves are given back.
+        bool committed = transaction.size() != 0 && transaction.commit();
+        for (const auto& [sp, location, address] : written) {
+            if (committed && transaction.written(address)) {
+                LOG("Patched '{}' @ {:s}", sp->patch.str(), location);
+            }
+        }
+        for (const auto& [location, address, cave] : diverted) {
+            if (committed && transaction.written(address)) {
+                LOG("Hooked @ {:s} to {:#x}", location, cave.address);
             }
             else {
-                LOG("Did not find '{}'", sp.signature);
+                Utils::Cave::release(cave);
             }
         }
+        if (committed) {
+            for (auto& site : sites) {
+                if (transaction.written(site->address())) {
+                    hookSites.push_back(std::move(site));
+                }
+            }
+            appliedPatches.push_back(std::move(transaction));
+        }
+
+        if (!cachePath.empty() && !cache.save(cachePath)) {
+            LOG("Failed to write '{:s}'", cachePath);
+        }
+
+        pendingPatches.clear();
+        pendingHooks.clear();
+        pendingCaves.clear();
     }
 }
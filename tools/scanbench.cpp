@@ -0,0 +1,271 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "scanner.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BENCH_RDTSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace
+{
+    constexpr size_t MIB = 1 << 20;
+    constexpr int REPEATS = 3;
+
+    /**
+     * @brief Small, fast PRNG so generating 512 MiB does not dominate the run.
+     */
+    struct XorShift {
+        u64 state = 0x9E3779B97F4A7C15ull;
+
+        u64 next()
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+    };
+
+    /**
+     * @brief Fills memory with bytes distributed roughly like x64 code.
+     * @details REX prefixes, common opcodes, zero bytes and int3 padding dominate real
+     *      code sections, which is what makes anchor selection and SIMD filtering work
+     *      harder than on uniformly random data.
+     */
+    void generateCode(std::vector<u8>& image, XorShift& rng)
+    {
+        static constexpr u8 COMMON[] = { 0x48, 0x8B, 0x89, 0x00, 0x0F, 0xCC, 0xE8, 0x24, 0x44, 0x4C, 0x8D, 0x85, 0xC0, 0xFF, 0x74, 0x83 };
+        for (size_t i = 0; i < image.size(); i += 8) {
+            u64 bits = rng.next();
+            for (size_t j = 0; j < 8 && i + j < image.size(); j++, bits >>= 8) {
+                u8 value = static_cast<u8>(bits);
+                image[i + j] = value < 160 ? COMMON[value & 15] : value;
+            }
+        }
+    }
+
+    /**
+     * @brief Position of the planted pattern relative to the size of the image.
+     */
+    enum class Position {
+        Early,
+        Late,
+        Absent
+    };
+
+    const char* positionName(Position position)
+    {
+        switch (position) {
+        case Position::Early:
+            return "early";
+        case Position::Late:
+            return "late";
+        default:
+            return "absent";
+        }
+    }
+
+    /**
+     * @brief A scanner implementation under test.
+     */
+    struct Path {
+        const char* name;
+        std::function<const u8*(std::span<const u8>, const Utils::PreparedPattern&)> scan;
+    };
+
+    /**
+     * @brief Builds a pattern from freshly generated code-like bytes.
+     * @details The bytes are generated independently of the image, so they do not
+     *      already occur at some random spot of it. The first byte is always exact,
+     *      every other byte is a wildcard with the given probability.
+     */
+    Utils::Pattern makePattern(size_t length, u32 wildcardPercent, XorShift& rng)
+    {
+        std::vector<u8> bytes(length);
+        generateCode(bytes, rng);
+
+        Utils::Pattern pattern;
+        for (size_t i = 0; i < length; i++) {
+            bool wildcard = i != 0 && rng.next() % 100 < wildcardPercent;
+            pattern.bytes.push_back(wildcard ? 0x00 : bytes[i]);
+            pattern.mask.push_back(wildcard ? 0x00 : 0xFF);
+        }
+        return pattern;
+    }
+
+    /**
+     * @brief Runs a scan several times and keeps the fastest run.
+     *
+     * @return std::pair<double, u64> containing seconds and TSC cycles of the fastest run.
+     */
+    std::pair<double, u64> measure(const std::function<const u8*()>& scan, const u8*& hit)
+    {
+        double bestSeconds = 1e30;
+        u64 bestCycles = 0;
+        for (int i = 0; i < REPEATS; i++) {
+            auto start = std::chrono::steady_clock::now();
+#if defined(BENCH_RDTSC)
+            u64 cycles = __rdtsc();
+#endif
+            hit = scan();
+#if defined(BENCH_RDTSC)
+            cycles = __rdtsc() - cycles;
+#else
+            u64 cycles = 0;
+#endif
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds < bestSeconds) {
+                bestSeconds = seconds;
+                bestCycles = cycles;
+            }
+        }
+        return { bestSeconds, bestCycles };
+    }
+}
+
+/**
+ * @brief Benchmarks the signature scanners on synthetic code images.
+ *
+ * @details
+ * For every image size, pattern length, wildcard density and hit position a
+ * pattern that does not occur in the image is generated, planted at the requested
+ * position and scanned for with the scalar reference and every optimized path the
+ * CPU supports. A reference hit anywhere but the planted position fails the run. Throughput is reported for the bytes each
+ * scan had to cover, i.e. up to the hit, together with TSC cycles per byte. A path
+ * that disagrees with the scalar reference is reported and fails the run.
+ *
+ * Usage: scanbench [size-in-MiB...]
+ */
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::stoul(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = { 16, 64, 256, 512 };
+    }
+    std::sort(sizes.begin(), sizes.end());
+
+    XorShift rng;
+    std::vector<u8> image(sizes.back() * MIB);
+    generateCode(image, rng);
+
+    // Sampled once per image size like the DLL does once per module, not per scan.
+    Utils::ByteFrequency frequency{};
+    Utils::ScanMode best = Utils::detectScanMode();
+    std::vector<Path> paths = {
+        { "scalar", [](auto region, const auto& prepared) { return Utils::scanScalar(region, prepared); } },
+        { "sse2", [](auto region, const auto& prepared) { return Utils::scanSse2(region, prepared); } },
+    };
+    if (best == Utils::ScanMode::Avx2) {
+        paths.push_back({ "avx2", [](auto region, const auto& prepared) { return Utils::scanAvx2(region, prepared); } });
+    }
+    paths.push_back({ "parallel", [](auto region, const auto& prepared) { return Utils::scanParallel(region, prepared); } });
+    paths.push_back({ "multi", [&frequency](auto region, const auto& prepared) {
+        Utils::MultiScanner scanner(frequency);
+        scanner.add(prepared.pattern);
+        return scanner.scan(region)[0];
+    } });
+
+    std::cout << "Best scanner: " << Utils::scanModeName(best) << "\n";
+    std::cout << std::left << std::setw(8) << "MiB" << std::setw(8) << "length" << std::setw(10) << "wildcard"
+        << std::setw(10) << "hit" << std::setw(10) << "path" << std::right << std::setw(12) << "MB/s"
+        << std::setw(14) << "cycles/byte" << "\n";
+
+    int result = 0;
+    for (size_t size : sizes) {
+        std::span<u8> region(image.data(), size * MIB);
+        frequency = Utils::sampleFrequency(std::span<const std::span<const u8>>(std::array{ std::span<const u8>(region) }));
+
+        for (size_t length : { 8, 16, 32, 64 }) {
+            for (u32 wildcards : { 0, 25, 50 }) {
+                for (Position position : { Position::Early, Position::Late, Position::Absent }) {
+                    auto pattern = makePattern(length, wildcards, rng);
+                    {
+                        // Flip the exact first byte until the pattern really is absent, so
+                        // the only hit is the one planted below.
+                        Utils::PreparedPattern check(pattern);
+                        while (Utils::scanScalar(region, check) != nullptr) {
+                            pattern.bytes[0]++;
+                        }
+                    }
+
+                    std::vector<u8> saved;
+                    size_t offset = 0;
+                    if (position != Position::Absent) {
+                        offset = position == Position::Early ? region.size() / 100 : region.size() - region.size() / 100;
+                        saved.assign(region.begin() + offset, region.begin() + offset + length);
+                        for (size_t i = 0; i < length; i++) {
+                            region[offset + i] = (region[offset + i] & ~pattern.mask[i]) | (pattern.bytes[i] & pattern.mask[i]);
+                        }
+                    }
+                    const u8* expected = position == Position::Absent ? nullptr : region.data() + offset;
+
+                    auto prepared = Utils::prepare(pattern, frequency);
+                    const u8* reference = nullptr;
+                    for (const auto& path : paths) {
+                        const u8* hit = nullptr;
+                        auto [seconds, cycles] = measure([&]() { return path.scan(region, prepared); }, hit);
+                        if (&path == &paths.front()) {
+                            reference = hit;
+                            if (reference != expected) {
+                                std::cout << "MISPLACED hit, planted at " << offset << "\n";
+                                result = 1;
+                            }
+                        }
+                        else if (hit != reference) {
+                            std::cout << "MISMATCH " << path.name << "\n";
+                            result = 1;
+                        }
+                        double covered = static_cast<double>(reference ? reference - region.data() + length : region.size());
+                        std::cout << std::left << std::setw(8) << size << std::setw(8) << length
+                            << std::setw(10) << (std::to_string(wildcards) + "%") << std::setw(10) << positionName(position)
+                            << std::setw(10) << path.name << std::right << std::fixed << std::setprecision(0)
+                            << std::setw(12) << covered / seconds / 1e6 << std::setprecision(3)
+                            << std::setw(14) << (cycles ? cycles / covered : 0.0) << "\n";
+                    }
+
+                    std::copy(saved.begin(), saved.end(), region.begin() + offset);
+                }
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "image.hpp"
+#include "scanner.hpp"
+#include "suffixarray.hpp"
+#include "generator.hpp"
+
+/**
+ * @brief Generates the shortest unique signature for locations in a game executable.
+ *
+ * @details
+ * For every RVA the instructions starting there are decoded, and the bytes that change
+ * between builds or load addresses are wildcarded. The shortest prefix that is unique
+ * within the executable sections is then found with the suffix array index. With
+ * `--back N` signatures starting up to N instructions earlier are tried as well, the
+ * shortest one is printed together with the offset to use in `SignatureHook::offset`.
+ *
+ * Usage: siggen <exe> [--cache <file>] [--back <count>] <rva>...
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <exe> [--cache <file>] [--back <count>] <rva>...\n";
+        return 1;
+    }
+
+    std::string cachePath;
+    size_t back = 0;
+    std::vector<u32> rvas;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cache" && i + 1 < argc) {
+            cachePath = argv[++i];
+        }
+        else if (arg == "--back" && i + 1 < argc) {
+            back = std::stoul(argv[++i]);
+        }
+        else {
+            rvas.push_back(static_cast<u32>(std::stoul(arg, nullptr, 16)));
+        }
+    }
+
+    Utils::ImageFile image;
+    if (!image.load(argv[1])) {
+        std::cerr << "Failed to load '" << argv[1] << "'\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Utils::CodeIndex index(image, cachePath);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::cerr << (index.cached() ? "Loaded" : "Built") << " index in " << elapsed.count() << " ms\n";
+
+    Utils::SignatureGenerator generator(image, index);
+    int result = 0;
+    for (u32 rva : rvas) {
+        auto signature = generator.generate(rva, back);
+        if (signature) {
+            std::cout << std::hex << rva << ": \"" << signature->text << "\" offset 0x"
+                << signature->offset << std::dec << " (" << signature->length << " bytes)\n";
+        }
+        else {
+            std::cout << std::hex << rva << std::dec << ": no unique signature within "
+                << Utils::Signature::MAX_SIZE << " bytes\n";
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <exception>
+
+#include "image.hpp"
+#include "scanner.hpp"
+#include "suffixarray.hpp"
+
+/**
+ * @brief Resolves signatures against a game executable using a suffix array.
+ *
+ * @details
+ * Meant for authoring signatures: the executable sections are indexed once, optionally
+ * cached on disk, and every signature is then answered without scanning the code.
+ * Signatures are taken from the command line, or one per line from stdin if none
+ * are given.
+ *
+ * Usage: sigindex <exe> [--cache <file>] [signature...]
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <exe> [--cache <file>] [signature...]\n";
+        return 1;
+    }
+
+    std::string cachePath;
+    std::vector<std::string> signatures;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cache" && i + 1 < argc) {
+            cachePath = argv[++i];
+        }
+        else {
+            signatures.push_back(arg);
+        }
+    }
+
+    Utils::ImageFile image;
+    if (!image.load(argv[1])) {
+        std::cerr << "Failed to load '" << argv[1] << "'\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Utils::CodeIndex index(image, cachePath);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::cerr << (index.cached() ? "Loaded" : "Built") << " index in " << elapsed.count() << " ms\n";
+
+    auto query = [&index](const std::string& signature) {
+        try {
+            auto pattern = Utils::compilePattern(signature);
+            auto hits = index.find(pattern);
+            std::cout << signature << "\n    " << std::dec << hits.size() << " hit(s)";
+            for (u32 rva : hits) {
+                std::cout << " " << std::hex << rva;
+            }
+            std::cout << std::dec << "\n";
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Invalid signature '" << signature << "': " << e.what() << "\n";
+        }
+    };
+
+    if (signatures.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                query(line);
+            }
+        }
+    }
+    for (const auto& signature : signatures) {
+        query(signature);
+    }
+    return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "image.hpp"
+#include "pe.hpp"
+#include "scanner.hpp"
+#include "suffixarray.hpp"
+#include "instructions.hpp"
+#include "generator.hpp"
+#include "signatures.hpp"
+
+namespace
+{
+    constexpr size_t FUNCTIONS_PER_BATCH = 256;
+    constexpr u32 NO_MATCH = UINT32_MAX;
+    constexpr i64 MATCH_WINDOW = 16;        // Functions a same-shape candidate may be away from its predicted index
+
+    /**
+     * @brief Functions of one build together with their shapes.
+     */
+    struct Build {
+        Utils::ImageFile image;
+        Utils::FunctionIndex functions;
+        std::vector<Utils::FunctionShape> shapes;
+    };
+
+    /**
+     * @brief Computes the shape of every function, spread over several threads.
+     */
+    void computeShapes(Build& build, u32 threads)
+    {
+        auto functions = build.functions.functions();
+        build.shapes.resize(functions.size());
+        size_t batches = (functions.size() + FUNCTIONS_PER_BATCH - 1) / FUNCTIONS_PER_BATCH;
+        std::atomic<size_t> next = 0;
+
+        auto worker = [&]() {
+            size_t batch;
+            while ((batch = next.fetch_add(1, std::memory_order_relaxed)) < batches) {
+                size_t last = std::min(functions.size(), (batch + 1) * FUNCTIONS_PER_BATCH);
+                for (size_t i = batch * FUNCTIONS_PER_BATCH; i < last; i++) {
+                    const auto& function = functions[i];
+                    const u8* code = build.image.at(function.begin, function.end - function.begin);
+                    if (code != nullptr) {
+                        build.shapes[i] = Utils::functionShape({ code, function.end - function.begin });
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (u32 i = 1; i < threads; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Matches the functions of two builds by their shapes.
+     * @details Shapes that occur exactly once in both builds are matched directly and
+     *      serve as anchors. Since the linker mostly keeps functions in the same order,
+     *      a function with a common shape is matched to the function with the same
+     *      shape closest to where the nearest preceding anchor predicts it. Candidates
+     *      more than `MATCH_WINDOW` functions away from that prediction are rejected, a
+     *      distant function that merely shares the shape is more likely wrong than right.
+     *
+     * @return std::vector<u32> containing the index of the matching new function for
+     *      every old function, `NO_MATCH` if there is none.
+     */
+    std::vector<u32> matchFunctions(const Build& before, const Build& after)
+    {
+        std::unordered_map<u64, std::vector<u32>> oldByHash, newByHash;
+        for (u32 i = 0; i < before.shapes.size(); i++) {
+            if (!before.shapes[i].offsets.empty()) {
+                oldByHash[before.shapes[i].hash].push_back(i);
+            }
+        }
+        for (u32 i = 0; i < after.shapes.size(); i++) {
+            if (!after.shapes[i].offsets.empty()) {
+                newByHash[after.shapes[i].hash].push_back(i);
+            }
+        }
+
+        std::vector<u32> matches(before.shapes.size(), NO_MATCH);
+        for (const auto& [hash, olds] : oldByHash) {
+            auto it = newByHash.find(hash);
+            if (olds.size() == 1 && it != newByHash.end() && it->second.size() == 1) {
+                matches[olds[0]] = it->second[0];
+            }
+        }
+
+        // Resolve the remaining functions relative to the closest preceding anchor.
+        u32 anchorOld = 0;
+        u32 anchorNew = 0;
+        for (u32 i = 0; i < before.shapes.size(); i++) {
+            if (matches[i] != NO_MATCH) {
+                anchorOld = i;
+                anchorNew = matches[i];
+                continue;
+            }
+            auto it = newByHash.find(before.shapes[i].hash);
+            if (before.shapes[i].offsets.empty() || it == newByHash.end()) {
+                continue;
+            }
+            i64 expected = static_cast<i64>(anchorNew) + (i - anchorOld);
+            u32 closest = *std::min_element(it->second.begin(), it->second.end(), [expected](u32 a, u32 b) {
+                return std::abs(static_cast<i64>(a) - expected) < std::abs(static_cast<i64>(b) - expected);
+            });
+            if (std::abs(static_cast<i64>(closest) - expected) <= MATCH_WINDOW) {
+                matches[i] = closest;
+            }
+        }
+        return matches;
+    }
+
+    /**
+     * @brief Maps an old RVA to the new build through the matched functions.
+     * @details The location is expressed as instruction index plus byte offset within
+     *      the instruction, matched functions have the same number of instructions.
+     */
+    std::optional<u32> migrate(const Build& before, const Build& after, const std::vector<u32>& matches, u32 rva)
+    {
+        const Utils::Function* function = before.functions.find(rva);
+        if (function == nullptr) {
+            return std::nullopt;
+        }
+        size_t index = function - before.functions.functions().data();
+        if (matches[index] == NO_MATCH) {
+            return std::nullopt;
+        }
+
+        const auto& offsets = before.shapes[index].offsets;
+        u32 delta = rva - function->begin;
+        auto instruction = std::upper_bound(offsets.begin(), offsets.end(), delta);
+        if (instruction == offsets.begin()) {
+            return std::nullopt;
+        }
+        instruction--;
+        size_t position = instruction - offsets.begin();
+
+        const auto& target = after.functions.functions()[matches[index]];
+        const auto& targetOffsets = after.shapes[matches[index]].offsets;
+        if (position >= targetOffsets.size()) {
+            return std::nullopt;
+        }
+        return target.begin + targetOffsets[position] + (delta - *instruction);
+    }
+
+    /**
+     * @brief Loads an image and computes the shapes of its functions.
+     */
+    bool loadBuild(Build& build, const std::string& path, u32 threads)
+    {
+        if (!build.image.load(path)) {
+            std::cerr << "Failed to load '" << path << "'\n";
+            return false;
+        }
+        build.functions = build.image.functions();
+        if (build.functions.empty()) {
+            std::cerr << "'" << path << "' has no .pdata\n";
+            return false;
+        }
+        computeShapes(build, threads);
+        return true;
+    }
+}
+
+/**
+ * @brief Migrates signatures from one game build to another.
+ *
+ * @details
+ * The functions of both builds are taken from .pdata and summarized by the shape of
+ * their instructions, see `Utils::functionShape`, then matched between the builds.
+ * Every location is mapped to the same instruction of the matching function in the
+ * new build and a fresh signature is generated there.
+ *
+ * Without RVAs the signatures of all fixes are migrated: each one is resolved in the
+ * old build, migrated and regenerated, the offset of the hook or patch stays the same.
+ *
+ * Usage: sigmigrate <old-exe> <new-exe> [--cache <file>] [--back <count>] [--threads <count>] [rva...]
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <old-exe> <new-exe> [--cache <file>] [--back <count>] [--threads <count>] [rva...]\n";
+        return 1;
+    }
+
+    std::string cachePath;
+    size_t back = 0;
+    u32 threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<u32> rvas;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cache" && i + 1 < argc) {
+            cachePath = argv[++i];
+        }
+        else if (arg == "--back" && i + 1 < argc) {
+            back = std::stoul(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1ul, std::stoul(argv[++i]));
+        }
+        else {
+            rvas.push_back(static_cast<u32>(std::stoul(arg, nullptr, 16)));
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Build before, after;
+    if (!loadBuild(before, argv[1], threads) || !loadBuild(after, argv[2], threads)) {
+        return 1;
+    }
+    auto matches = matchFunctions(before, after);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    size_t matched = std::count_if(matches.begin(), matches.end(), [](u32 match) { return match != NO_MATCH; });
+    std::cerr << "Matched " << matched << " of " << matches.size() << " functions in " << elapsed.count() << " ms\n";
+
+    Utils::CodeIndex index(after.image, cachePath);
+    Utils::SignatureGenerator generator(after.image, index);
+    int result = 0;
+
+    auto report = [&](u32 rva, size_t lookBack) {
+        auto migrated = migrate(before, after, matches, rva);
+        if (!migrated) {
+            std::cout << "    " << std::hex << rva << " -> no matching function\n" << std::dec;
+            result = 1;
+            return;
+        }
+        std::cout << "    " << std::hex << rva << " -> " << *migrated << std::dec << "\n";
+        auto signature = generator.generate(*migrated, lookBack);
+        if (signature) {
+            std::cout << "    \"" << signature->text << "\" offset 0x" << std::hex << signature->offset << std::dec << "\n";
+        }
+        else {
+            std::cout << "    no unique signature within " << Utils::Signature::MAX_SIZE << " bytes\n";
+            result = 1;
+        }
+    };
+
+    if (rvas.empty()) {
+        Utils::CodeIndex oldIndex(before.image);
+        for (const auto& entry : Signatures::ALL) {
+            std::cout << entry.name << " (offset 0x" << std::hex << entry.offset << std::dec << ")\n";
+            if (!index.find(entry.signature.view(), 2).empty()) {
+                std::cout << "    signature still matches the new build\n";
+            }
+            // Only a single hit makes hits[0] meaningful, a limited find returns an
+            // arbitrary subset of the hits.
+            auto hits = oldIndex.find(entry.signature.view(), 2);
+            if (hits.size() != 1) {
+                std::cout << (hits.empty() ? "    signature not found" : "    signature is ambiguous") << " in the old build, skipped\n";
+                result = 1;
+                continue;
+            }
+            report(hits[0], 0);
+        }
+    }
+    for (u32 rva : rvas) {
+        std::cout << std::hex << rva << std::dec << "\n";
+        report(rva, back);
+    }
+    return result;
+}
@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+
+#include "image.hpp"
+#include "scanner.hpp"
+#include "signatures.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief Converts a hit inside one of the mapped sections into its RVA.
+     */
+    u32 toRva(const std::vector<Utils::MappedSection>& sections, const u8* hit)
+    {
+        for (const auto& section : sections) {
+            if (hit >= section.bytes.data() && hit < section.bytes.data() + section.bytes.size()) {
+                return section.rva + static_cast<u32>(hit - section.bytes.data());
+            }
+        }
+        return 0;
+    }
+}
+
+/**
+ * @brief Resolves the signatures of all fixes against a game executable on disk.
+ *
+ * @details
+ * Checks a new game build without launching the game: the executable is memory-mapped,
+ * its executable sections are scanned the same way the DLL scans them, and for every
+ * signature the RVA of its first hit, the RVA of the hook or patch, the number of
+ * matches and the scan time are printed. Exits with 1 if a signature is not found,
+ * with `--strict` also if a signature is ambiguous.
+ *
+ * Usage: sigscan <exe> [--strict]
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <exe> [--strict]\n";
+        return 1;
+    }
+    bool strict = argc > 2 && std::string(argv[2]) == "--strict";
+
+    auto start = Clock::now();
+    Utils::ImageFile image;
+    if (!image.load(argv[1])) {
+        std::cerr << "Failed to load '" << argv[1] << "'\n";
+        return 1;
+    }
+    auto sections = image.sections();
+    std::vector<std::span<const u8>> regions;
+    size_t total = 0;
+    for (const auto& section : sections) {
+        regions.push_back(section.bytes);
+        total += section.bytes.size();
+    }
+    std::cout << "Mapped " << argv[1] << " in " << millisecondsSince(start) << " ms, "
+        << sections.size() << " executable section(s), " << (total >> 20) << " MiB, "
+        << Utils::scanModeName(Utils::detectScanMode()) << "\n";
+
+    int result = 0;
+    for (const auto& entry : Signatures::ALL) {
+        start = Clock::now();
+        Utils::MultiScanner scanner;
+        scanner.add(entry.signature.view());
+        auto hits = scanner.scanAll(regions)[0];
+        double elapsed = millisecondsSince(start);
+
+        std::cout << entry.name << "\n    ";
+        if (hits.empty()) {
+            std::cout << "not found";
+            result = 1;
+        }
+        else {
+            u32 rva = toRva(sections, hits[0]);
+            std::cout << "rva " << std::hex << rva << ", target " << rva + entry.offset << std::dec;
+            if (hits.size() > 1 && strict) {
+                result = 1;
+            }
+        }
+        std::cout << ", " << hits.size() << " match(es), " << elapsed << " ms\n";
+    }
+
+    // The DLL resolves all signatures in one shared, chunked scan.
+    start = Clock::now();
+    Utils::MultiScanner scanner;
+    for (const auto& entry : Signatures::ALL) {
+        scanner.add(entry.signature.view());
+    }
+    scanner.scanAll(regions);
+    std::cout << "All signatures in one chunked scan: " << millisecondsSince(start) << " ms\n";
+    return result;
+}